@@ -0,0 +1,158 @@
+// Lookup of the reply function for a Lib protocol address: the two std::map of the original handler against
+// the 256 entry table indexed by the low byte that BMSLibProtocolUARTHandler uses now. Both are filled with the
+// addresses the handler supports and looked up with the polling cycle of MPPInverterSimulator. The table is a
+// copy of the handler's lookup, which is private.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *memory = malloc(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+namespace
+{
+    struct Handler
+    {
+        void replyNoParam(uint8_t *) {}
+        void replyDataAddress(uint8_t *, uint16_t) {}
+    };
+
+    using NoParamFunc = void (Handler::*)(uint8_t *);
+    using DataAddressFunc = void (Handler::*)(uint8_t *, uint16_t);
+
+    const uint8_t FIXED_LOW_BYTES[] = {0x01, 0x02, 0x03, 0x05, 0x10, 0x25, 0x30, 0x31, 0x32, 0x33, 0x34, 0x40, 0x50,
+                                       0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x70, 0x71, 0x72,
+                                       0x73, 0x74, 0x75};
+    const struct
+    {
+        uint8_t first;
+        uint8_t last;
+    } PAGED_LOW_BYTES[] = {{0x11, 0x24}, {0x26, 0x2F}, {0x41, 0x4A}, {0x51, 0x55}};
+    constexpr uint16_t MAX_PAGE = 0x0F;
+
+    const uint16_t POLLING_CYCLE[] = {0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0033, 0x0010, 0x0011, 0x0012, 0x0013,
+                                      0x0014, 0x0015, 0x0016, 0x0017, 0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D,
+                                      0x001E, 0x001F, 0x0020, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x0030, 0x0031,
+                                      0x0032, 0x0034, 0x0040, 0x0050, 0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065,
+                                      0x0070, 0x0115, 0x0999};
+
+    struct MapDispatch
+    {
+        std::map<uint16_t, NoParamFunc> noParam;
+        std::map<uint16_t, DataAddressFunc> dataAddress;
+
+        MapDispatch()
+        {
+            for (uint8_t lowByte : FIXED_LOW_BYTES)
+                noParam[lowByte] = &Handler::replyNoParam;
+            for (const auto &range : PAGED_LOW_BYTES)
+                for (uint16_t page = 0; page <= MAX_PAGE; page++)
+                    for (uint16_t lowByte = range.first; lowByte <= range.last; lowByte++)
+                        dataAddress[(page << 8) | lowByte] = &Handler::replyDataAddress;
+        }
+
+        bool dispatch(Handler &handler, uint8_t *reply, uint16_t address) const
+        {
+            auto noParamFunc = noParam.find(address);
+            if (noParamFunc != noParam.end())
+            {
+                (handler.*(noParamFunc->second))(reply);
+                return true;
+            }
+            auto dataAddressFunc = dataAddress.find(address);
+            if (dataAddressFunc != dataAddress.end())
+            {
+                (handler.*(dataAddressFunc->second))(reply, address);
+                return true;
+            }
+            return false;
+        }
+    };
+
+    struct TableDispatch
+    {
+        struct Entry
+        {
+            NoParamFunc noParamFunc;
+            DataAddressFunc dataAddressFunc;
+        };
+        std::array<Entry, 256> table{};
+
+        TableDispatch()
+        {
+            for (uint8_t lowByte : FIXED_LOW_BYTES)
+                table[lowByte].noParamFunc = &Handler::replyNoParam;
+            for (const auto &range : PAGED_LOW_BYTES)
+                for (uint16_t lowByte = range.first; lowByte <= range.last; lowByte++)
+                    table[lowByte].dataAddressFunc = &Handler::replyDataAddress;
+        }
+
+        bool dispatch(Handler &handler, uint8_t *reply, uint16_t address) const
+        {
+            const uint16_t page = address >> 8;
+            const Entry &entry = table[address & 0x00FF];
+            if (page == 0x00 && entry.noParamFunc != nullptr)
+            {
+                (handler.*(entry.noParamFunc))(reply);
+                return true;
+            }
+            if (page <= MAX_PAGE && entry.dataAddressFunc != nullptr)
+            {
+                (handler.*(entry.dataAddressFunc))(reply, address);
+                return true;
+            }
+            return false;
+        }
+    };
+
+    template <typename Dispatch>
+    void run(const char *name, const Dispatch &dispatch)
+    {
+        Handler handler;
+        uint8_t reply[10];
+        const size_t rounds = 2000000;
+        volatile size_t dispatched = 0;
+
+        const auto startedAt = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; round++)
+        {
+            // volatile keeps the compiler from hoisting the lookups out of the loop
+            for (uint16_t address : POLLING_CYCLE)
+                dispatched = dispatched + dispatch.dispatch(handler, reply, address);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - startedAt;
+
+        printf("%-10s %6.2f ns/lookup\n", name, elapsed.count() / (rounds * (sizeof(POLLING_CYCLE) / sizeof(POLLING_CYCLE[0]))));
+    }
+} // namespace
+
+int main()
+{
+    size_t before = allocations;
+    MapDispatch *mapDispatch = new MapDispatch();
+    printf("std::map   %zu heap allocations, %zu entries\n", allocations - before - 1,
+           mapDispatch->noParam.size() + mapDispatch->dataAddress.size());
+
+    before = allocations;
+    static const TableDispatch tableDispatch;
+    printf("table      %zu heap allocations, %zu bytes\n", allocations - before, sizeof(tableDispatch.table));
+
+    run("std::map", *mapDispatch);
+    run("table", tableDispatch);
+    delete mapDispatch;
+    return 0;
+}
@@ -0,0 +1,143 @@
+// BMSLibProtocolFrameParser under fault injection. Each scenario is a stream of read requests with a fault in
+// front of every one of them. Reported per scenario: parsing speed, the requests found, and how many bytes after
+// the end of a fault it took until a request was returned, 8 when the one right after the fault was found.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bms_lib_protocol_frame_parser.h"
+
+using namespace sdragos::mppsolar;
+
+namespace
+{
+    constexpr uint8_t SLAVE_ID = 0x01;
+    constexpr size_t SEGMENTS = 200000;
+
+    using Bytes = std::vector<uint8_t>;
+
+    struct Stream
+    {
+        Bytes bytes;
+        // Where the request after each fault starts
+        std::vector<size_t> requestStarts;
+    };
+
+    Bytes readRequest(std::mt19937 &random)
+    {
+        const uint16_t address = 0x0010 + random() % 0x65;
+        Bytes frame{SLAVE_ID, 0x03, (uint8_t)(address >> 8), (uint8_t)address, 0x00, 0x01};
+        const uint16_t crc = ModbusCrc16::compute(frame.data(), frame.size());
+        frame.push_back((uint8_t)crc);
+        frame.push_back((uint8_t)(crc >> 8));
+        return frame;
+    }
+
+    using Fault = void (*)(std::mt19937 &, Bytes &);
+
+    void noFault(std::mt19937 &, Bytes &) {}
+
+    void randomNoise(std::mt19937 &random, Bytes &out)
+    {
+        for (int i = 0; i < 32; i++)
+            out.push_back((uint8_t)random());
+    }
+
+    // Slave ID bytes followed by the write function and a large byte count, each one a candidate that stays
+    // in progress for up to 255 bytes
+    void falseWriteStarts(std::mt19937 &random, Bytes &out)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            const Bytes start{SLAVE_ID, 0x10, 0x00, 0x70, 0x00, 0x7B, 0xF6};
+            out.insert(out.end(), start.begin(), start.end());
+        }
+    }
+
+    void truncatedRequest(std::mt19937 &random, Bytes &out)
+    {
+        const Bytes request = readRequest(random);
+        out.insert(out.end(), request.begin(), request.begin() + 1 + random() % (request.size() - 1));
+    }
+
+    void bitFlippedRequest(std::mt19937 &random, Bytes &out)
+    {
+        Bytes request = readRequest(random);
+        request[random() % request.size()] ^= 1 << (random() % 8);
+        out.insert(out.end(), request.begin(), request.end());
+    }
+
+    // The echo of our own reply on a half-duplex adapter: [id][fn][byte count][2 bytes][crc]
+    void replyEcho(std::mt19937 &random, Bytes &out)
+    {
+        Bytes reply{SLAVE_ID, 0x03, 0x02, (uint8_t)random(), (uint8_t)random()};
+        const uint16_t crc = ModbusCrc16::compute(reply.data(), reply.size());
+        reply.push_back((uint8_t)crc);
+        reply.push_back((uint8_t)(crc >> 8));
+        out.insert(out.end(), reply.begin(), reply.end());
+    }
+
+    Stream buildStream(Fault fault)
+    {
+        std::mt19937 random(1);
+        Stream stream;
+        for (size_t segment = 0; segment < SEGMENTS; segment++)
+        {
+            fault(random, stream.bytes);
+            stream.requestStarts.push_back(stream.bytes.size());
+            const Bytes request = readRequest(random);
+            stream.bytes.insert(stream.bytes.end(), request.begin(), request.end());
+        }
+        return stream;
+    }
+
+    void run(const char *name, Fault fault)
+    {
+        const Stream stream = buildStream(fault);
+
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        std::vector<size_t> frameEnds;
+        frameEnds.reserve(SEGMENTS);
+
+        const auto startedAt = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < stream.bytes.size(); i++)
+        {
+            if (parser.feed(stream.bytes[i]) == FrameParserResult::Frame)
+                frameEnds.push_back(i + 1);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startedAt;
+
+        // For each request, the bytes from its start to the first frame returned at or after its end
+        size_t found = 0;
+        size_t resyncBytes = 0;
+        size_t resyncs = 0;
+        size_t nextFrame = 0;
+        for (size_t start : stream.requestStarts)
+        {
+            while (nextFrame < frameEnds.size() && frameEnds[nextFrame] < start + 8)
+                nextFrame++;
+            if (nextFrame == frameEnds.size())
+                break;
+            if (frameEnds[nextFrame] == start + 8)
+                found++;
+            resyncBytes += frameEnds[nextFrame] - start;
+            resyncs++;
+        }
+
+        printf("%-22s %8.1f MB/s %9zu of %zu requests %8.2f bytes to first frame\n", name,
+               stream.bytes.size() / elapsed.count() / 1e6, found, stream.requestStarts.size(),
+               resyncs != 0 ? (double)resyncBytes / resyncs : 0.0);
+    }
+} // namespace
+
+int main()
+{
+    run("clean", &noFault);
+    run("random noise", &randomNoise);
+    run("false write starts", &falseWriteStarts);
+    run("truncated request", &truncatedRequest);
+    run("bit flipped request", &bitFlippedRequest);
+    run("reply echo", &replyEcho);
+    return 0;
+}
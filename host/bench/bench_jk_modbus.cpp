@@ -0,0 +1,122 @@
+// JkModbus receive path on clean and worst-case streams. Each scenario is a stream of captured status frames
+// with noise in front of every one of them, fed through loop() from memory. Reported per scenario: parsing
+// speed and the status frames found. The worst cases are runs of frame headers with the largest valid length,
+// every start byte in them is a false start that takes in the bytes of the next ones.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "esp_log.h"
+#include "jk_captured_frames.h"
+#include "memory_uart_component.h"
+#include "esphome/components/jk_modbus/jk_modbus.h"
+
+using namespace esphome::jk_modbus;
+using host_test::MemoryUARTComponent;
+
+namespace
+{
+    constexpr size_t SEGMENTS = 20000;
+
+    using Bytes = std::vector<uint8_t>;
+
+    class CountingDevice : public JkModbusDevice
+    {
+    public:
+        size_t frames = 0;
+
+        void on_jk_modbus_data(const uint8_t &, const JkFrameView &) override { frames++; }
+        void update() override {}
+    };
+
+    using Noise = void (*)(std::mt19937 &, Bytes &);
+
+    void noNoise(std::mt19937 &, Bytes &) {}
+
+    void randomNoise(std::mt19937 &random, Bytes &out)
+    {
+        for (int i = 0; i < 64; i++)
+            out.push_back((uint8_t)random());
+    }
+
+    // Start bytes only, each one is buffered and dropped at the next byte
+    void startByteFlood(std::mt19937 &, Bytes &out) { out.insert(out.end(), 64, 0x4E); }
+
+    // Headers with the largest length the parser accepts, each one takes in the next ones
+    void longHeaders(std::mt19937 &, Bytes &out)
+    {
+        const Bytes header{0x4E, 0x57, 0x02, 0x58};
+        for (int i = 0; i < 16; i++)
+            out.insert(out.end(), header.begin(), header.end());
+    }
+
+    // A run of such headers longer than a frame, every start byte in it is a false start of 600 bytes
+    void headerRun(std::mt19937 &, Bytes &out)
+    {
+        const Bytes header{0x4E, 0x57, 0x02, 0x58};
+        for (int i = 0; i < 160; i++)
+            out.insert(out.end(), header.begin(), header.end());
+    }
+
+    // Headers of 597 bytes that repeat every 5 bytes, so the end of frame of each one is found where it is
+    // expected and only the checksum is wrong
+    void endByteHeaders(std::mt19937 &, Bytes &out)
+    {
+        const Bytes header{0x4E, 0x57, 0x02, 0x55, 0x68};
+        for (int i = 0; i < 128; i++)
+            out.insert(out.end(), header.begin(), header.end());
+    }
+
+    void corruptFrame(std::mt19937 &random, Bytes &out)
+    {
+        Bytes frame(std::begin(host_test::JK_STATUS_FRAME_14_CELLS), std::end(host_test::JK_STATUS_FRAME_14_CELLS));
+        frame[4 + random() % (frame.size() - 4)] ^= 1 << (random() % 8);
+        out.insert(out.end(), frame.begin(), frame.end());
+    }
+
+    void run(const char *name, Noise noise)
+    {
+        std::mt19937 random(1);
+        Bytes stream;
+        for (size_t segment = 0; segment < SEGMENTS; segment++)
+        {
+            noise(random, stream);
+            stream.insert(stream.end(), std::begin(host_test::JK_STATUS_FRAME_14_CELLS),
+                          std::end(host_test::JK_STATUS_FRAME_14_CELLS));
+        }
+        // Flushes a false start at the end
+        stream.insert(stream.end(), 700, 0x00);
+
+        MemoryUARTComponent uart;
+        JkModbus modbus;
+        CountingDevice device;
+        modbus.set_uart_parent(&uart);
+        device.set_parent(&modbus);
+        device.set_address(0x4E);
+        modbus.register_device(&device);
+
+        uart.receive(stream);
+        const auto startedAt = std::chrono::steady_clock::now();
+        while (uart.available() > 0)
+            modbus.loop();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startedAt;
+
+        printf("%-18s %8.1f MB/s %7zu of %zu status frames\n", name, stream.size() / elapsed.count() / 1e6,
+               device.frames, SEGMENTS);
+    }
+} // namespace
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    run("clean", &noNoise);
+    run("random noise", &randomNoise);
+    run("start byte flood", &startByteFlood);
+    run("long headers", &longHeaders);
+    run("header run", &headerRun);
+    run("end byte headers", &endByteHeaders);
+    run("corrupt frame", &corruptFrame);
+    return 0;
+}
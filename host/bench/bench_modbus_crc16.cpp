@@ -0,0 +1,63 @@
+// Time per frame of the CRC16 engines on the frame sizes of the Lib protocol: a request, a single value reply
+// and the largest block reply. updateBitwise is the loop the handler used before the table driven engine.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "modbus_crc16.h"
+
+using namespace sdragos::mppsolar;
+
+using UpdateFunction = uint16_t (*)(uint16_t, const uint8_t *, size_t);
+
+static volatile uint16_t sink;
+
+static double nanosecondsPerFrame(UpdateFunction update, const std::vector<uint8_t> &frames, size_t frameSize)
+{
+    const size_t frameCount = frames.size() / frameSize;
+    const size_t rounds = 20000000 / frames.size() + 1;
+
+    const auto startedAt = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (size_t frame = 0; frame < frameCount; frame++)
+            sink = update(ModbusCrc16::INITIAL_VALUE, frames.data() + frame * frameSize, frameSize);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - startedAt;
+    return elapsed.count() / (rounds * frameCount);
+}
+
+int main()
+{
+    static const struct
+    {
+        const char *name;
+        UpdateFunction update;
+    } ENGINES[] = {
+        {"bitwise", &ModbusCrc16::updateBitwise},
+        {"table", &ModbusCrc16::updateSliced<1>},
+        {"slice-by-4", &ModbusCrc16::updateSliced<4>},
+        {"slice-by-8", &ModbusCrc16::updateSliced<8>},
+    };
+    static const size_t FRAME_SIZES[] = {6, 8, 256};
+
+    std::mt19937 random(1);
+    std::vector<uint8_t> frames(64 * 1024);
+    for (uint8_t &byte : frames)
+        byte = (uint8_t)random();
+
+    printf("%-12s", "ns/frame");
+    for (size_t frameSize : FRAME_SIZES)
+        printf("%12zu B", frameSize);
+    printf("\n");
+
+    for (const auto &engine : ENGINES)
+    {
+        printf("%-12s", engine.name);
+        for (size_t frameSize : FRAME_SIZES)
+            printf("%14.1f", nanosecondsPerFrame(engine.update, frames, frameSize));
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+// JkBms decoding of the data JkModbus hands over, on arbitrary data. The first byte of the input picks a status
+// frame or the reply to one of the registers of a fast update, the rest is the data, record number included.
+
+#include "esp_log.h"
+#include "memory_uart_component.h"
+#include "esphome/components/jk_bms/jk_bms.h"
+
+using namespace esphome;
+
+namespace
+{
+    class FuzzJkBms : public jk_bms::JkBms
+    {
+    public:
+        // A fast update that waits for the reply to the given register, past the end when there is none
+        void expectRegister(uint8_t index) { fast_register_index_ = index; }
+    };
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static const bool initialized = []() {
+        esp_log_level_set("*", ESP_LOG_NONE);
+        return true;
+    }();
+    (void)initialized;
+
+    if (size == 0)
+        return 0;
+
+    // The fast update asks for its next register through JkModbus
+    host_test::MemoryUARTComponent uart;
+    jk_modbus::JkModbus modbus;
+    FuzzJkBms bms;
+    modbus.set_uart_parent(&uart);
+    bms.set_parent(&modbus);
+    bms.set_address(0x4E);
+
+    const jk_modbus::JkFrameView frame(data + 1, size - 1);
+    if ((data[0] & 0x80) == 0)
+    {
+        bms.on_jk_modbus_data(0x06, frame);
+    }
+    else
+    {
+        bms.expectRegister(data[0] & 0x07);
+        bms.on_jk_modbus_data(0x03, frame);
+    }
+    return 0;
+}
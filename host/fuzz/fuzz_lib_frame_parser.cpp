@@ -0,0 +1,30 @@
+// BMSLibProtocolFrameParser on arbitrary bytes. A reported frame must have a valid CRC and a supported length,
+// anything else aborts like a crash.
+
+#include <cstdlib>
+#include "bms_lib_protocol_frame_parser.h"
+
+using namespace sdragos::mppsolar;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    // The first byte picks the slave ID, so the frames of the seeds match it most of the time
+    if (size == 0)
+        return 0;
+    BMSLibProtocolFrameParser parser(data[0] < 0xF0 ? 0x01 : data[0]);
+
+    for (size_t i = 1; i < size; i++)
+    {
+        const FrameParserResult result = parser.feed(data[i]);
+        if (result == FrameParserResult::Incomplete)
+            continue;
+
+        const size_t length = parser.frameLength();
+        if (length < BMSLibProtocolFrameParser::READ_FRAME_SIZE || length > BMSLibProtocolFrameParser::MAX_FRAME_SIZE)
+            abort();
+        const uint16_t crc = ModbusCrc16::compute(parser.frame(), length);
+        if ((result == FrameParserResult::Frame) != (crc == 0))
+            abort();
+    }
+    return 0;
+}
@@ -0,0 +1,202 @@
+// Runs a libFuzzer target without libFuzzer, for compilers that don't have it. The seed inputs are run first,
+// then inputs made by mutating them: bit flips, byte changes, inserts, erases, cuts and splices of two inputs. There
+// is no coverage feedback, an input that finds something new is not kept. A crash is left to the sanitizers,
+// the input that caused it is written to crash-<run> first.
+//
+//   fuzz_target [-runs=N] [-max_total_time=S] [-max_len=N] [-seed=N] [corpus dirs or files...]
+//
+// The options are the libFuzzer ones, so the same command runs either build.
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __SANITIZE_ADDRESS__
+#include <sanitizer/common_interface_defs.h>
+#define HAS_SANITIZER_INTERFACE 1
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace
+{
+    using Bytes = std::vector<uint8_t>;
+
+    const Bytes *currentInput = nullptr;
+    unsigned long long currentRun = 0;
+
+    void writeCurrentInput()
+    {
+        if (currentInput == nullptr)
+            return;
+        const std::string path = "crash-" + std::to_string(currentRun);
+        std::ofstream(path, std::ios::binary).write((const char *)currentInput->data(), currentInput->size());
+        fprintf(stderr, "Crash on run %llu, the %zu byte input is written to %s\n", currentRun, currentInput->size(),
+                path.c_str());
+    }
+
+    void onSignal(int signal)
+    {
+        writeCurrentInput();
+        std::signal(signal, SIG_DFL);
+        std::raise(signal);
+    }
+
+    void addSeeds(const std::filesystem::path &path, std::vector<Bytes> &seeds)
+    {
+        if (std::filesystem::is_directory(path))
+        {
+            for (const auto &entry : std::filesystem::directory_iterator(path))
+                addSeeds(entry.path(), seeds);
+            return;
+        }
+        std::ifstream file(path, std::ios::binary);
+        seeds.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void mutate(std::mt19937 &random, const std::vector<Bytes> &seeds, size_t maxLength, Bytes &input)
+    {
+        const int mutations = 1 + random() % 8;
+        for (int i = 0; i < mutations; i++)
+        {
+            const size_t at = input.empty() ? 0 : random() % input.size();
+            switch (random() % 7)
+            {
+            case 0:
+                if (!input.empty())
+                    input[at] ^= 1 << (random() % 8);
+                break;
+            case 1:
+                if (!input.empty())
+                    input[at] = (uint8_t)random();
+                break;
+            case 2:
+                input.insert(input.begin() + at, 1 + random() % 8, (uint8_t)random());
+                break;
+            case 3:
+                if (!input.empty())
+                    input.erase(input.begin() + at, input.begin() + at + std::min<size_t>(1 + random() % 8, input.size() - at));
+                break;
+            case 4:
+                // A field of the input set to the edge values lengths and counts break at
+                if (!input.empty())
+                {
+                    static const uint8_t EDGES[] = {0x00, 0x01, 0x7F, 0x80, 0xFE, 0xFF};
+                    input[at] = EDGES[random() % sizeof(EDGES)];
+                }
+                break;
+            case 5:
+                // Cut off, where a length or count runs past the end of the data
+                input.resize(at);
+                break;
+            default:
+            {
+                // A piece of another input, which carries the start sequences and IDs of the seeds along
+                const Bytes &other = seeds[random() % seeds.size()];
+                if (other.empty())
+                    break;
+                const size_t from = random() % other.size();
+                const size_t length = std::min<size_t>(1 + random() % 64, other.size() - from);
+                input.insert(input.begin() + at, other.begin() + from, other.begin() + from + length);
+                break;
+            }
+            }
+        }
+        if (input.size() > maxLength)
+            input.resize(maxLength);
+    }
+
+    unsigned long long option(int argc, char **argv, const char *name, unsigned long long fallback)
+    {
+        const size_t length = strlen(name);
+        for (int i = 1; i < argc; i++)
+        {
+            if (strncmp(argv[i], name, length) == 0)
+                return strtoull(argv[i] + length, nullptr, 10);
+        }
+        return fallback;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned long long runs = option(argc, argv, "-runs=", ULLONG_MAX);
+    const unsigned long long maxTotalTime = option(argc, argv, "-max_total_time=", 0);
+    const size_t maxLength = option(argc, argv, "-max_len=", 4096);
+    std::mt19937 random((uint32_t)option(argc, argv, "-seed=", 1));
+
+    std::vector<Bytes> seeds;
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+            addSeeds(argv[i], seeds);
+    }
+    if (seeds.empty())
+        seeds.emplace_back();
+
+#ifdef HAS_SANITIZER_INTERFACE
+    __sanitizer_set_death_callback(&writeCurrentInput);
+#endif
+    std::signal(SIGSEGV, &onSignal);
+    std::signal(SIGABRT, &onSignal);
+    std::signal(SIGFPE, &onSignal);
+
+    printf("INFO: %zu seed inputs, max_len %zu\n", seeds.size(), maxLength);
+    const auto startedAt = std::chrono::steady_clock::now();
+    auto elapsedSeconds = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count(); };
+
+    Bytes input;
+    double reportAt = 1.0;
+    for (currentRun = 0; currentRun < runs; currentRun++)
+    {
+        if (currentRun < seeds.size())
+        {
+            input = seeds[currentRun];
+        }
+        else
+        {
+            input = seeds[random() % seeds.size()];
+            mutate(random, seeds, maxLength, input);
+        }
+
+        // A copy of exactly the input size, so AddressSanitizer sees any read past its end. The spare capacity
+        // of the vector would hide it.
+        currentInput = &input;
+        uint8_t *copy = new uint8_t[input.size()];
+        std::copy(input.begin(), input.end(), copy);
+        LLVMFuzzerTestOneInput(copy, input.size());
+        delete[] copy;
+        currentInput = nullptr;
+
+        if ((currentRun & 0x3FF) == 0)
+        {
+            const double elapsed = elapsedSeconds();
+            if (elapsed >= reportAt)
+            {
+                printf("#%llu\texec/s: %.0f\n", currentRun + 1, (currentRun + 1) / elapsed);
+                fflush(stdout);
+                reportAt *= 2;
+            }
+            if (maxTotalTime != 0 && elapsed >= maxTotalTime)
+            {
+                currentRun++;
+                break;
+            }
+        }
+    }
+
+    const double elapsed = elapsedSeconds();
+    printf("Done %llu runs in %.1f s, exec/s: %.0f, crashes: 0\n", currentRun, elapsed,
+           elapsed > 0 ? currentRun / elapsed : 0.0);
+    return 0;
+}
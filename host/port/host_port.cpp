@@ -0,0 +1,166 @@
+// Host implementations of the ESP-IDF and FreeRTOS functions declared in port/include.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "hal/cpu_hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+
+namespace
+{
+    const std::chrono::steady_clock::time_point START = std::chrono::steady_clock::now();
+
+    esp_log_level_t logLevel = ESP_LOG_INFO;
+
+    std::chrono::milliseconds ticksToDuration(TickType_t ticks)
+    {
+        return std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS);
+    }
+} // namespace
+
+// A mutex is a binary semaphore that starts given. Unlike a FreeRTOS mutex, it can be given by any thread
+// and has no priority inheritance, neither matters on the host.
+struct HostSemaphore
+{
+    std::mutex lock;
+    std::condition_variable given;
+    bool available;
+};
+
+int64_t esp_timer_get_time(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - START).count();
+}
+
+uint32_t cpu_hal_get_cycle_count(void)
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - START).count();
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    logLevel = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > logLevel)
+        return;
+
+    static const char LETTERS[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+    printf("%c (%lld) %s: ", LETTERS[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void vPortYield(void)
+{
+    std::this_thread::yield();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(ticksToDuration(ticks));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t semaphore = new HostSemaphore();
+    semaphore->available = true;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    SemaphoreHandle_t semaphore = new HostSemaphore();
+    semaphore->available = false;
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (ticks == portMAX_DELAY)
+        semaphore->given.wait(lock, [semaphore]() { return semaphore->available; });
+    else if (!semaphore->given.wait_for(lock, ticksToDuration(ticks), [semaphore]() { return semaphore->available; }))
+        return pdFALSE;
+
+    semaphore->available = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    {
+        std::lock_guard<std::mutex> lock(semaphore->lock);
+        if (semaphore->available)
+            return pdFALSE;
+        semaphore->available = true;
+    }
+    semaphore->given.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    if (ticks != portMAX_DELAY)
+        vTaskDelay(ticks);
+    return pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    return pdPASS;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    default:
+        return "ESP_FAIL";
+    }
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_set_line_inverse(uart_port_t uart_num, uint32_t inverse_mask) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, uint8_t tout_thresh) { return ESP_ERR_NOT_SUPPORTED; }
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size) { return -1; }
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait) { return -1; }
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    *size = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_flush_input(uart_port_t uart_num) { return ESP_ERR_NOT_SUPPORTED; }
@@ -0,0 +1,101 @@
+// Host version of the ESP-IDF UART driver API, so IDFUARTComponent compiles. The host has no UART, every call
+// fails with ESP_ERR_NOT_SUPPORTED. Use VirtualUARTComponent to run the bridge on the host.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+const char *esp_err_to_name(esp_err_t code);
+
+typedef int uart_port_t;
+#define UART_NUM_MAX 3
+#define UART_PIN_NO_CHANGE (-1)
+#define SOC_UART_FIFO_LEN 128
+
+#define UART_SIGNAL_TXD_INV (1 << 3)
+#define UART_SIGNAL_RXD_INV (1 << 0)
+
+typedef enum
+{
+    UART_DATA_5_BITS,
+    UART_DATA_6_BITS,
+    UART_DATA_7_BITS,
+    UART_DATA_8_BITS,
+    UART_DATA_BITS_MAX,
+} uart_word_length_t;
+
+typedef enum
+{
+    UART_STOP_BITS_1 = 1,
+    UART_STOP_BITS_1_5,
+    UART_STOP_BITS_2,
+    UART_STOP_BITS_MAX,
+} uart_stop_bits_t;
+
+typedef enum
+{
+    UART_PARITY_DISABLE = 0,
+    UART_PARITY_EVEN = 2,
+    UART_PARITY_ODD = 3,
+} uart_parity_t;
+
+typedef enum
+{
+    UART_HW_FLOWCTRL_DISABLE,
+} uart_hw_flowcontrol_t;
+
+typedef enum
+{
+    UART_SCLK_APB,
+} uart_sclk_t;
+
+typedef struct
+{
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    uart_sclk_t source_clk;
+} uart_config_t;
+
+typedef enum
+{
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct
+{
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+} uart_event_t;
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_set_line_inverse(uart_port_t uart_num, uint32_t inverse_mask);
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, uint8_t tout_thresh);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size);
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait);
+esp_err_t uart_flush_input(uart_port_t uart_num);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// Sleeps the calling thread, the ROM version waits in a loop
+void esp_rom_delay_us(uint32_t us);
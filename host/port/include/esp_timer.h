@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// Microseconds since the program started, from the monotonic clock of the host
+int64_t esp_timer_get_time(void);
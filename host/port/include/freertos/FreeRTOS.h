@@ -0,0 +1,27 @@
+// Host version of the FreeRTOS types and macros used by the bridge. Semaphores are built on the C++
+// standard library, one tick is one millisecond.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+typedef struct HostQueue *QueueHandle_t;
+typedef struct HostSemaphore *SemaphoreHandle_t;
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) * configTICK_RATE_HZ / 1000)
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+void vPortYield(void);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Only the UART driver creates queues, and the host has none, so there is never anything to receive
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t queue);
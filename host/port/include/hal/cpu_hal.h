@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// The host has no cycle counter that is cheap to read, this counts nanoseconds instead
+uint32_t cpu_hal_get_cycle_count(void);
@@ -0,0 +1,19 @@
+// Host build configuration. Mirrors the defaults of main/Kconfig.projbuild, the firmware gets the generated one.
+
+#pragma once
+
+#define CONFIG_BMS_LIB_UART_PORT_NUM 1
+#define CONFIG_BMS_LIB_UART_BAUD_RATE 9600
+#define CONFIG_BMS_LIB_FRAME_COMPLETION_ON_INTER_FRAME_SILENCE 1
+#define CONFIG_BMS_LIB_PREDICT_NEXT_REQUEST 1
+#define CONFIG_BMS_LIB_SIMULATOR_REQUEST_GAP_MS 50
+#define CONFIG_BMS_LIB_SIMULATOR_LATE_REPLY_US 20000
+#define CONFIG_BMS_LIB_CRC16_TABLE 1
+
+#define CONFIG_JK_UART_PORT_NUM 2
+#define CONFIG_JK_UART_BAUD_RATE 115200
+#define CONFIG_JK_BMS_MIN_UPDATE_INTERVAL_MS 1000
+#define CONFIG_JK_BMS_MAX_UPDATE_INTERVAL_MS 10000
+#define CONFIG_JK_BMS_UPLOAD_TIMEOUT_MS 10000
+#define CONFIG_JK_BMS_FULL_UPDATE_INTERVAL_MS 60000
+#define CONFIG_JK_BMS_TERMINAL_NUMBER 0x0
@@ -0,0 +1,126 @@
+// Runs the Lib protocol handler against the simulated inverter on the host, like the firmware does with
+// CONFIG_BMS_LIB_INVERTER_SIMULATOR, and prints the stats of both sides at the end.
+//
+//   host_simulator [--seconds N] [--baud N] [--gap-ms N] [--late-us N] [--fixed-delay] [--no-prediction]
+//
+// Exits with 1 when a request was not replied to or a reply was invalid.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "bms_lib_protocol_uart_handler.h"
+#include "bms_lib_protocol_mock_data_adapter.h"
+#include "mpp_inverter_simulator.h"
+#include "virtual_uart_component.h"
+
+using namespace sdragos::mppsolar;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t seconds = 5;
+        uint32_t baudRate = CONFIG_BMS_LIB_UART_BAUD_RATE;
+        uint32_t requestGapMs = CONFIG_BMS_LIB_SIMULATOR_REQUEST_GAP_MS;
+        uint32_t lateReplyUs = CONFIG_BMS_LIB_SIMULATOR_LATE_REPLY_US;
+        bool fixedDelay = false;
+        bool prediction = true;
+    };
+
+    bool parseOptions(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const bool hasValue = i + 1 < argc;
+            if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+                options.seconds = strtoul(argv[++i], nullptr, 10);
+            else if (strcmp(argv[i], "--baud") == 0 && hasValue)
+                options.baudRate = strtoul(argv[++i], nullptr, 10);
+            else if (strcmp(argv[i], "--gap-ms") == 0 && hasValue)
+                options.requestGapMs = strtoul(argv[++i], nullptr, 10);
+            else if (strcmp(argv[i], "--late-us") == 0 && hasValue)
+                options.lateReplyUs = strtoul(argv[++i], nullptr, 10);
+            else if (strcmp(argv[i], "--fixed-delay") == 0)
+                options.fixedDelay = true;
+            else if (strcmp(argv[i], "--no-prediction") == 0)
+                options.prediction = false;
+            else
+                return false;
+        }
+        return options.baudRate != 0;
+    }
+
+    VirtualUARTComponent *newVirtualUart(uint32_t baudRate)
+    {
+        VirtualUARTComponent *uart = new VirtualUARTComponent();
+        uart->set_baud_rate(baudRate);
+        uart->set_data_bits(8);
+        uart->set_stop_bits(1);
+        uart->set_parity(UARTParityOptions::UART_CONFIG_PARITY_NONE);
+        return uart;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: %s [--seconds N] [--baud N] [--gap-ms N] [--late-us N] [--fixed-delay] [--no-prediction]\n", argv[0]);
+        return 2;
+    }
+
+    // The handler logs every reply at debug level, only the summary is of interest here
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    VirtualUARTComponent *handlerUart = newVirtualUart(options.baudRate);
+    VirtualUARTComponent *inverterUart = newVirtualUart(options.baudRate);
+    VirtualUARTComponent::connect(handlerUart, inverterUart);
+
+    MPPInverterSimulator inverter(inverterUart);
+    inverter.setRequestGapMs(options.requestGapMs);
+    inverter.setLateReplyUs(options.lateReplyUs);
+
+    BMSLibProtocolMockDataAdapter dataAdapter;
+    BMSLibProtocolUARTHandler handler(handlerUart);
+    handler.setDataAdapter(&dataAdapter);
+    handler.setFrameCompletionMode(options.fixedDelay ? FrameCompletionMode::FixedDelay : FrameCompletionMode::InterFrameSilence);
+    handler.setRequestPredictionEnabled(options.prediction);
+    handler.setup();
+
+    // The same two tasks the firmware runs, see main.cpp
+    std::atomic<bool> running{true};
+    std::thread handlerTask([&]() {
+        while (running.load())
+        {
+            handlerUart->waitForData(10 / portTICK_PERIOD_MS);
+            handler.loop();
+        }
+    });
+    std::thread inverterTask([&]() {
+        while (running.load())
+        {
+            inverterUart->waitForData(1);
+            inverter.loop();
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    running.store(false);
+    handlerTask.join();
+    inverterTask.join();
+
+    printf("%lu baud, %lu ms request gap, %s, request prediction %s\n", (unsigned long)options.baudRate,
+           (unsigned long)options.requestGapMs, options.fixedDelay ? "fixed delay" : "inter-frame silence",
+           options.prediction ? "enabled" : "disabled");
+    esp_log_level_set("*", ESP_LOG_INFO);
+    inverter.dump_config();
+    handler.dump_config();
+
+    const MPPInverterSimulator::Stats &stats = inverter.getStats();
+    return stats.replies == 0 || stats.missedReplies != 0 || stats.invalidReplies != 0 ? 1 : 0;
+}
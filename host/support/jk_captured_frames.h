@@ -0,0 +1,49 @@
+// Status frames of JK BMS packs, captured on the RS485 bus, from the start sequence to the checksum. The data of
+// the first one is the fake status frame of JkBms, the second one the commented out one next to it.
+
+#pragma once
+
+#include <cstdint>
+
+namespace host_test
+{
+    // 14 cells, protocol version 1, software H6.X__S6.1.3S__
+    const uint8_t JK_STATUS_FRAME_14_CELLS[] = {
+        0x4E, 0x57, 0x01, 0x1B, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x79, 0x2A, 0x01, 0x0E, 0xED, 0x02, 0x0E,
+        0xFA, 0x03, 0x0E, 0xF7, 0x04, 0x0E, 0xEC, 0x05, 0x0E, 0xF8, 0x06, 0x0E, 0xFA, 0x07, 0x0E, 0xF1, 0x08, 0x0E,
+        0xF8, 0x09, 0x0E, 0xE3, 0x0A, 0x0E, 0xFA, 0x0B, 0x0E, 0xF1, 0x0C, 0x0E, 0xFB, 0x0D, 0x0E, 0xFB, 0x0E, 0x0E,
+        0xF2, 0x80, 0x00, 0x1D, 0x81, 0x00, 0x1E, 0x82, 0x00, 0x1C, 0x83, 0x14, 0xEF, 0x84, 0x80, 0xD0, 0x85, 0x0F,
+        0x86, 0x02, 0x87, 0x00, 0x04, 0x89, 0x00, 0x00, 0x00, 0x00, 0x8A, 0x00, 0x0E, 0x8B, 0x00, 0x00, 0x8C, 0x00,
+        0x07, 0x8E, 0x16, 0x26, 0x8F, 0x10, 0xAE, 0x90, 0x0F, 0xD2, 0x91, 0x0F, 0xA0, 0x92, 0x00, 0x05, 0x93, 0x0B,
+        0xEA, 0x94, 0x0C, 0x1C, 0x95, 0x00, 0x05, 0x96, 0x01, 0x2C, 0x97, 0x00, 0x07, 0x98, 0x00, 0x03, 0x99, 0x00,
+        0x05, 0x9A, 0x00, 0x05, 0x9B, 0x0C, 0xE4, 0x9C, 0x00, 0x08, 0x9D, 0x01, 0x9E, 0x00, 0x5A, 0x9F, 0x00, 0x46,
+        0xA0, 0x00, 0x64, 0xA1, 0x00, 0x64, 0xA2, 0x00, 0x14, 0xA3, 0x00, 0x46, 0xA4, 0x00, 0x46, 0xA5, 0xFF, 0xEC,
+        0xA6, 0xFF, 0xF6, 0xA7, 0xFF, 0xEC, 0xA8, 0xFF, 0xF6, 0xA9, 0x0E, 0xAA, 0x00, 0x00, 0x00, 0x0E, 0xAB, 0x01,
+        0xAC, 0x01, 0xAD, 0x04, 0x11, 0xAE, 0x01, 0xAF, 0x01, 0xB0, 0x00, 0x0A, 0xB1, 0x14, 0xB2, 0x31, 0x32, 0x33,
+        0x34, 0x35, 0x36, 0x00, 0x00, 0x00, 0x00, 0xB3, 0x00, 0xB4, 0x49, 0x6E, 0x70, 0x75, 0x74, 0x20, 0x55, 0x73,
+        0xB5, 0x32, 0x31, 0x30, 0x31, 0xB6, 0x00, 0x00, 0xE2, 0x00, 0xB7, 0x48, 0x36, 0x2E, 0x58, 0x5F, 0x5F, 0x53,
+        0x36, 0x2E, 0x31, 0x2E, 0x33, 0x53, 0x5F, 0x5F, 0xB8, 0x00, 0xB9, 0x00, 0x00, 0x00, 0x00, 0xBA, 0x42, 0x54,
+        0x33, 0x30, 0x37, 0x32, 0x30, 0x32, 0x30, 0x31, 0x32, 0x30, 0x30, 0x30, 0x30, 0x32, 0x30, 0x30, 0x35, 0x32,
+        0x31, 0x30, 0x30, 0x31, 0xC0, 0x01, 0x00, 0x00, 0x00, 0x00, 0x68, 0x00, 0x00, 0x54, 0xD1,
+    };
+
+    // 13 cells, two of them not connected, software H7.X__S7.1.0H__
+    const uint8_t JK_STATUS_FRAME_13_CELLS[] = {
+        0x4E, 0x57, 0x01, 0x18, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x79, 0x27, 0x01, 0x00, 0x00, 0x02, 0x00,
+        0x00, 0x03, 0x10, 0x34, 0x04, 0x10, 0x28, 0x05, 0x10, 0x29, 0x06, 0x10, 0x35, 0x07, 0x10, 0x2B, 0x08, 0x10,
+        0x2B, 0x09, 0x10, 0x35, 0x0A, 0x10, 0x35, 0x0B, 0x10, 0x35, 0x0C, 0x10, 0x3D, 0x0D, 0x10, 0x26, 0x80, 0x00,
+        0x1A, 0x81, 0x00, 0x18, 0x82, 0x00, 0x18, 0x83, 0x11, 0xCE, 0x84, 0x00, 0x00, 0x85, 0x00, 0x86, 0x02, 0x87,
+        0x00, 0x00, 0x89, 0x00, 0x00, 0x00, 0x00, 0x8A, 0x00, 0x0D, 0x8B, 0x00, 0x00, 0x8C, 0x00, 0x08, 0x8E, 0x15,
+        0x54, 0x8F, 0x0E, 0xBA, 0x90, 0x10, 0x68, 0x91, 0x10, 0x04, 0x92, 0x00, 0x05, 0x93, 0x0B, 0x54, 0x94, 0x0C,
+        0x80, 0x95, 0x00, 0x05, 0x96, 0x01, 0x2C, 0x97, 0x00, 0x3C, 0x98, 0x01, 0x2C, 0x99, 0x00, 0x19, 0x9A, 0x00,
+        0x1E, 0x9B, 0x0C, 0xE4, 0x9C, 0x00, 0x0A, 0x9D, 0x01, 0x9E, 0x00, 0x5A, 0x9F, 0x00, 0x46, 0xA0, 0x00, 0x64,
+        0xA1, 0x00, 0x64, 0xA2, 0x00, 0x14, 0xA3, 0x00, 0x46, 0xA4, 0x00, 0x46, 0xA5, 0xFF, 0xEC, 0xA6, 0xFF, 0xF6,
+        0xA7, 0xFF, 0xEC, 0xA8, 0xFF, 0xF6, 0xA9, 0x0D, 0xAA, 0x00, 0x00, 0x00, 0x05, 0xAB, 0x00, 0xAC, 0x00, 0xAD,
+        0x02, 0xD5, 0xAE, 0x01, 0xAF, 0x01, 0xB0, 0x00, 0x0A, 0xB1, 0x14, 0xB2, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
+        0x00, 0x00, 0x00, 0x00, 0xB3, 0x00, 0xB4, 0x49, 0x6E, 0x70, 0x75, 0x74, 0x20, 0x55, 0x73, 0xB5, 0x32, 0x31,
+        0x30, 0x36, 0xB6, 0x00, 0x00, 0x00, 0x00, 0xB7, 0x48, 0x37, 0x2E, 0x58, 0x5F, 0x5F, 0x53, 0x37, 0x2E, 0x31,
+        0x2E, 0x30, 0x48, 0x5F, 0x5F, 0xB8, 0x00, 0xB9, 0x00, 0x00, 0x00, 0x00, 0xBA, 0x42, 0x54, 0x33, 0x30, 0x37,
+        0x32, 0x30, 0x32, 0x30, 0x31, 0x32, 0x30, 0x30, 0x30, 0x30, 0x32, 0x30, 0x30, 0x35, 0x32, 0x31, 0x30, 0x30,
+        0x31, 0xC0, 0x01, 0x00, 0x00, 0x00, 0x00, 0x68, 0x00, 0x00, 0x47, 0x28,
+    };
+} // namespace host_test
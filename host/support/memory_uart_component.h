@@ -0,0 +1,74 @@
+// A UART that receives from memory, for the JkModbus tests, benchmarks and fuzz targets. The bytes handed to
+// receive() are returned by the reads right away, in chunks of at most the chunk size, written bytes are kept.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "esphome/components/uart/uart_component.h"
+
+namespace host_test
+{
+    class MemoryUARTComponent : public esphome::uart::UARTComponent
+    {
+    public:
+        void receive(const uint8_t *data, size_t len)
+        {
+            // The bytes that were read are dropped first, so a long run doesn't keep them all
+            if (_rxPosition == _rx.size())
+            {
+                _rx.clear();
+                _rxPosition = 0;
+            }
+            _rx.insert(_rx.end(), data, data + len);
+        }
+        void receive(const std::vector<uint8_t> &data) { receive(data.data(), data.size()); }
+
+        /// Limits the bytes a read returns, to hand a frame over in pieces
+        void setChunkSize(size_t chunkSize) { _chunkSize = chunkSize; }
+
+        std::vector<uint8_t> &written() { return _written; }
+
+        void write_array(const uint8_t *data, size_t len) override { _written.insert(_written.end(), data, data + len); }
+
+        bool peek_byte(uint8_t *data) override
+        {
+            if (_rxPosition == _rx.size())
+                return false;
+            *data = _rx[_rxPosition];
+            return true;
+        }
+
+        bool read_array(uint8_t *data, size_t len) override
+        {
+            if (_rx.size() - _rxPosition < len)
+                return false;
+            if (len != 0)
+                memcpy(data, _rx.data() + _rxPosition, len);
+            _rxPosition += len;
+            return true;
+        }
+
+        size_t read_available(uint8_t *data, size_t max_len) override
+        {
+            const size_t len = std::min({max_len, _chunkSize, _rx.size() - _rxPosition});
+            if (len == 0)
+                return 0;
+            memcpy(data, _rx.data() + _rxPosition, len);
+            _rxPosition += len;
+            return len;
+        }
+
+        int available() override { return (int)(_rx.size() - _rxPosition); }
+        void flush() override {}
+        bool is_tx_done() override { return true; }
+
+    private:
+        std::vector<uint8_t> _rx;
+        size_t _rxPosition = 0;
+        size_t _chunkSize = SIZE_MAX;
+        std::vector<uint8_t> _written;
+    };
+} // namespace host_test
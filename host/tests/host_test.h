@@ -0,0 +1,45 @@
+// Minimal checks for the host tests, which are plain executables run by ctest. A failed check prints its
+// location and makes the test return 1, the test goes on so every failure of a run is reported.
+
+#pragma once
+
+#include <cstdio>
+
+namespace host_test
+{
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline int result()
+    {
+        if (failures() != 0)
+            printf("%d check(s) failed\n", failures());
+        return failures() != 0 ? 1 : 0;
+    }
+} // namespace host_test
+
+#define CHECK(condition)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            host_test::failures()++;                                            \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                                                        \
+    do                                                                                                       \
+    {                                                                                                        \
+        const long long expectedValue = (long long)(expected);                                               \
+        const long long actualValue = (long long)(actual);                                                   \
+        if (expectedValue != actualValue)                                                                    \
+        {                                                                                                    \
+            printf("%s:%d: CHECK_EQUAL(%s, %s) failed, %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, \
+                   expectedValue, actualValue);                                                              \
+            host_test::failures()++;                                                                         \
+        }                                                                                                    \
+    } while (0)
@@ -0,0 +1,242 @@
+// BMSLibProtocolFrameParser: frame lengths, CRC checks and resynchronisation after noise, false starts, more
+// false starts than there are candidates and frames that wrap around the end of the ring buffer.
+
+#include <random>
+#include <vector>
+#include "host_test.h"
+#include "bms_lib_protocol_frame_parser.h"
+
+using namespace sdragos::mppsolar;
+
+namespace
+{
+    constexpr uint8_t SLAVE_ID = 0x01;
+
+    using Bytes = std::vector<uint8_t>;
+
+    Bytes withCrc(Bytes frame)
+    {
+        const uint16_t crc = ModbusCrc16::compute(frame.data(), frame.size());
+        frame.push_back((uint8_t)crc);
+        frame.push_back((uint8_t)(crc >> 8));
+        return frame;
+    }
+
+    Bytes readRequest(uint16_t address, uint16_t registers)
+    {
+        return withCrc({SLAVE_ID, 0x03, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(registers >> 8), (uint8_t)registers});
+    }
+
+    Bytes writeRequest(uint16_t address, const Bytes &values)
+    {
+        Bytes frame{SLAVE_ID, 0x10, (uint8_t)(address >> 8), (uint8_t)address, 0, (uint8_t)(values.size() / 2), (uint8_t)values.size()};
+        frame.insert(frame.end(), values.begin(), values.end());
+        return withCrc(frame);
+    }
+
+    struct Fed
+    {
+        std::vector<Bytes> frames;
+        size_t invalidCrc = 0;
+    };
+
+    Fed feed(BMSLibProtocolFrameParser &parser, const Bytes &stream)
+    {
+        Fed fed;
+        for (uint8_t byte : stream)
+        {
+            const FrameParserResult result = parser.feed(byte);
+            if (result == FrameParserResult::Frame)
+                fed.frames.emplace_back(parser.frame(), parser.frame() + parser.frameLength());
+            else if (result == FrameParserResult::InvalidCrc)
+                fed.invalidCrc++;
+        }
+        return fed;
+    }
+
+    Bytes concat(std::initializer_list<Bytes> parts)
+    {
+        Bytes stream;
+        for (const Bytes &part : parts)
+            stream.insert(stream.end(), part.begin(), part.end());
+        return stream;
+    }
+
+    void testReadAndWriteFrames()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        const Bytes read = readRequest(0x0033, 1);
+        const Bytes write = writeRequest(0x0070, {0x02, 0x10, 0x01, 0xE0});
+
+        Fed fed = feed(parser, concat({read, write}));
+        CHECK_EQUAL(2, fed.frames.size());
+        CHECK_EQUAL(0, fed.invalidCrc);
+        CHECK(fed.frames.size() == 2 && fed.frames[0] == read && fed.frames[1] == write);
+        CHECK(parser.isIdle());
+    }
+
+    void testInvalidCrc()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        Bytes read = readRequest(0x0072, 1);
+        read[7] ^= 0x40;
+
+        Fed fed = feed(parser, read);
+        CHECK_EQUAL(0, fed.frames.size());
+        CHECK_EQUAL(1, fed.invalidCrc);
+        CHECK_EQUAL(8, parser.frameLength());
+        CHECK(parser.isIdle());
+
+        // The next frame is found as usual
+        fed = feed(parser, readRequest(0x0072, 1));
+        CHECK_EQUAL(1, fed.frames.size());
+    }
+
+    void testUnsupportedFrames()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+
+        // Another slave, an unsupported function and a write longer than Modbus allows are skipped silently
+        Bytes otherSlave = readRequest(0x0033, 1);
+        otherSlave[0] = 0x02;
+        const Bytes unsupported = withCrc({SLAVE_ID, 0x06, 0x00, 0x70, 0x02, 0x10});
+        const Bytes tooLong{SLAVE_ID, 0x10, 0x00, 0x70, 0x00, 0x7C, 0xF8};
+
+        Fed fed = feed(parser, concat({otherSlave, unsupported, tooLong}));
+        CHECK_EQUAL(0, fed.frames.size());
+        CHECK_EQUAL(0, fed.invalidCrc);
+
+        fed = feed(parser, readRequest(0x0010, 1));
+        CHECK_EQUAL(1, fed.frames.size());
+    }
+
+    void testResyncAfterFalseStarts()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        const Bytes read = readRequest(0x0011, 1);
+
+        // Slave ID bytes in the noise start candidates that are still in progress when the real frame starts,
+        // and the payload of the real frame holds the slave ID too
+        const Bytes noise{0x55, SLAVE_ID, 0x03, 0x00, SLAVE_ID, 0xAA};
+        const Bytes write = writeRequest(0x0101, {SLAVE_ID, SLAVE_ID});
+
+        Fed fed = feed(parser, concat({noise, read, noise, write}));
+        CHECK_EQUAL(2, fed.frames.size());
+        CHECK(fed.frames.size() == 2 && fed.frames[0] == read && fed.frames[1] == write);
+        // The false starts were not reported, the real frames were still in progress
+        CHECK_EQUAL(0, fed.invalidCrc);
+    }
+
+    void testMoreFalseStartsThanCandidates()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        const Bytes read = readRequest(0x0072, 1);
+
+        // Write starts with the largest byte count, each one in progress for 255 bytes, more of them than
+        // there are candidates. The real frame takes the place of the oldest.
+        Bytes falseStarts;
+        for (size_t i = 0; i < 2 * BMSLibProtocolFrameParser::MAX_CANDIDATES; i++)
+            falseStarts.insert(falseStarts.end(), {SLAVE_ID, 0x10, 0x00, 0x70, 0x00, 0x7B, 0xF6});
+
+        Fed fed = feed(parser, concat({falseStarts, read}));
+        CHECK_EQUAL(1, fed.frames.size());
+        CHECK(fed.frames.size() == 1 && fed.frames[0] == read);
+        CHECK_EQUAL(0, fed.invalidCrc);
+        CHECK(parser.isIdle());
+    }
+
+    void testTruncatedFrame()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        const Bytes read = readRequest(0x0025, 1);
+
+        // The first request is cut after 5 bytes, the next one starts inside its candidate
+        Bytes truncated(read.begin(), read.begin() + 5);
+        Fed fed = feed(parser, concat({truncated, read}));
+        CHECK_EQUAL(1, fed.frames.size());
+        CHECK(fed.frames.size() == 1 && fed.frames[0] == read);
+    }
+
+    void testReset()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        const Bytes read = readRequest(0x0030, 1);
+
+        feed(parser, Bytes(read.begin(), read.begin() + 4));
+        CHECK(!parser.isIdle());
+        parser.reset();
+        CHECK(parser.isIdle());
+
+        // The rest of the interrupted frame does not complete anything
+        Fed fed = feed(parser, Bytes(read.begin() + 4, read.end()));
+        CHECK_EQUAL(0, fed.frames.size());
+        CHECK_EQUAL(0, fed.invalidCrc);
+    }
+
+    void testFramesAcrossTheRingEnd()
+    {
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+
+        // Frames of different lengths, so they start at every offset of the ring. The longest one is larger
+        // than the rest of the ring wherever it starts after the first bytes.
+        Bytes values;
+        for (size_t i = 0; i < 200; i++)
+            values.push_back((uint8_t)(i * 7));
+        const Bytes longWrite = writeRequest(0x0070, values);
+
+        for (int round = 0; round < 300; round++)
+        {
+            const Bytes frame = round % 5 == 0 ? longWrite : readRequest(0x0011 + round % 20, 1 + round % 3);
+            Fed fed = feed(parser, frame);
+            CHECK(fed.frames.size() == 1 && fed.frames[0] == frame);
+        }
+    }
+
+    void testRandomStream()
+    {
+        // Whatever the input, a reported frame has a valid CRC and a supported length
+        BMSLibProtocolFrameParser parser(SLAVE_ID);
+        std::mt19937 random(1);
+        const Bytes read = readRequest(0x0033, 1);
+
+        size_t frames = 0;
+        size_t injected = 0;
+        size_t injectedFound = 0;
+        for (int i = 0; i < 1000000; i++)
+        {
+            // A third of the noise is the slave ID or the read function, to start many candidates
+            const uint32_t kind = random() % 6;
+            const uint8_t byte = kind == 0 ? SLAVE_ID : kind == 1 ? 0x03 : (uint8_t)random();
+            const FrameParserResult result = parser.feed(byte);
+            if (result == FrameParserResult::Frame)
+            {
+                frames++;
+                CHECK_EQUAL(0, ModbusCrc16::compute(parser.frame(), parser.frameLength()));
+            }
+            if (result != FrameParserResult::Incomplete)
+                CHECK(parser.frameLength() >= BMSLibProtocolFrameParser::READ_FRAME_SIZE &&
+                      parser.frameLength() <= BMSLibProtocolFrameParser::MAX_FRAME_SIZE);
+
+            if (i % 1000 == 0)
+            {
+                injected++;
+                injectedFound += feed(parser, read).frames.size();
+            }
+        }
+        printf("random stream: %zu of %zu injected frames found, %zu found in the noise\n", injectedFound, injected, frames);
+    }
+} // namespace
+
+int main()
+{
+    testReadAndWriteFrames();
+    testInvalidCrc();
+    testUnsupportedFrames();
+    testResyncAfterFalseStarts();
+    testMoreFalseStartsThanCandidates();
+    testTruncatedFrame();
+    testReset();
+    testFramesAcrossTheRingEnd();
+    testRandomStream();
+    return host_test::result();
+}
@@ -0,0 +1,299 @@
+// JkBms decoder: the captured status frames against the values the Lib protocol replies are built from, frames
+// that are cut off, hold unknown registers or lack essential ones, record numbers that hold register IDs, the
+// fast updates that read single registers through JkModbus and the fallback to full updates when they fail.
+
+#include <map>
+#include <vector>
+#include "host_test.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "jk_captured_frames.h"
+#include "memory_uart_component.h"
+#include "esphome/components/jk_bms/jk_bms.h"
+
+using namespace esphome;
+using host_test::MemoryUARTComponent;
+
+namespace
+{
+    using Bytes = std::vector<uint8_t>;
+
+    constexpr uint8_t FUNCTION_READ_REGISTER = 0x03;
+    constexpr uint8_t FUNCTION_READ_ALL = 0x06;
+    constexpr size_t REQUEST_SIZE = 21;
+
+    Bytes captured(const uint8_t *frame, size_t size) { return Bytes(frame, frame + size); }
+
+    const Bytes STATUS_14 = captured(host_test::JK_STATUS_FRAME_14_CELLS, sizeof(host_test::JK_STATUS_FRAME_14_CELLS));
+    const Bytes STATUS_13 = captured(host_test::JK_STATUS_FRAME_13_CELLS, sizeof(host_test::JK_STATUS_FRAME_13_CELLS));
+
+    // The data JkModbus hands over: from after the frame type to the end sequence, the record number included
+    Bytes dataOf(const Bytes &frame) { return Bytes(frame.begin() + 11, frame.end() - 5); }
+
+    Bytes frameOf(uint8_t function, const Bytes &data)
+    {
+        Bytes frame{0x4E, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, function, 0x00, 0x01};
+        // End sequence and the 2 unused bytes
+        const Bytes tail{0x68, 0x00, 0x00};
+        frame.reserve(frame.size() + data.size() + tail.size() + 2);
+        frame.insert(frame.end(), data.begin(), data.end());
+        frame.insert(frame.end(), tail.begin(), tail.end());
+        frame[2] = (uint8_t)(frame.size() >> 8);
+        frame[3] = (uint8_t)frame.size();
+        uint16_t checksum = 0;
+        for (uint8_t byte : frame)
+            checksum += byte;
+        frame.push_back((uint8_t)(checksum >> 8));
+        frame.push_back((uint8_t)checksum);
+        return frame;
+    }
+
+    class TestJkBms : public jk_bms::JkBms
+    {
+    public:
+        size_t notifications = 0;
+
+        TestJkBms()
+        {
+            set_address(0x4E);
+            addOnDataUpdatedCallback([this]() { notifications++; });
+        }
+
+        bool hasFullUpdate() const { return has_full_update_; }
+        uint8_t protocolVersion() const { return (uint8_t)protocol_version_sensor_; }
+        bool fastUpdatesSupported() const { return fast_updates_supported_; }
+        uint8_t fastUpdateFailures() const { return fast_update_failures_; }
+        void status(const Bytes &data) { on_jk_modbus_data(FUNCTION_READ_ALL, jk_modbus::JkFrameView(data.data(), data.size())); }
+    };
+
+    // A pack on the bus: answers read all requests with a status frame and single register reads from a table
+    struct Bus
+    {
+        MemoryUARTComponent uart;
+        jk_modbus::JkModbus modbus;
+        TestJkBms bms;
+        Bytes statusFrame = STATUS_14;
+        // The data of the reply to each register, the record number included
+        std::map<uint8_t, Bytes> registerReplies;
+
+        Bus()
+        {
+            modbus.set_uart_parent(&uart);
+            bms.set_parent(&modbus);
+            modbus.register_device(&bms);
+        }
+
+        void answer()
+        {
+            Bytes &written = uart.written();
+            while (written.size() >= REQUEST_SIZE)
+            {
+                const uint8_t function = written[8];
+                const uint8_t address = written[11];
+                written.erase(written.begin(), written.begin() + REQUEST_SIZE);
+                if (function == FUNCTION_READ_ALL)
+                    uart.receive(statusFrame);
+                else if (function == FUNCTION_READ_REGISTER && registerReplies.count(address) != 0)
+                    uart.receive(frameOf(FUNCTION_READ_REGISTER, registerReplies[address]));
+            }
+        }
+
+        // Polls until the condition holds, or for at most a second
+        template <typename Condition>
+        void serveUntil(Condition condition)
+        {
+            const int64_t deadlineUs = esp_timer_get_time() + 1000 * 1000;
+            while (!condition() && esp_timer_get_time() < deadlineUs)
+            {
+                modbus.loop();
+                answer();
+            }
+        }
+
+        // Polls until the given number of snapshots is published
+        void serve(size_t notifications)
+        {
+            serveUntil([&]() { return bms.notifications >= notifications; });
+        }
+    };
+
+    void testCapturedFrames()
+    {
+        TestJkBms bms;
+        bms.status(dataOf(STATUS_14));
+        CHECK_EQUAL(1, bms.notifications);
+        CHECK(bms.hasFullUpdate());
+        CHECK_EQUAL(1, bms.protocolVersion());
+        CHECK_EQUAL(14, bms.getNumberOfCells());
+        // 3.821 V, 3.834 V, in 0.1 V
+        CHECK_EQUAL(38, bms.getCellVoltageOrNull(1));
+        CHECK_EQUAL(38, bms.getCellVoltageOrNull(14));
+        CHECK_EQUAL(0, bms.getCellVoltageOrNull(15));
+        // 53.59 V, 2.08 A charging, 15 % of 14 Ah
+        CHECK_EQUAL(535, bms.getModuleVoltage());
+        CHECK_EQUAL(20, bms.getModuleChargeCurrent());
+        CHECK_EQUAL(0, bms.getModuleDischargeCurrent());
+        CHECK_EQUAL(15, bms.getStateOfCharge());
+        CHECK_EQUAL(14000, bms.getModuleTotalCapacity());
+        // 30 °C and 28 °C, in 0.1 K
+        CHECK_EQUAL(2, bms.getNumberOfTemperatureSensors());
+        CHECK_EQUAL(3031, bms.getTemperatureOfSensorOrNull(1));
+        CHECK_EQUAL(3011, bms.getTemperatureOfSensorOrNull(2));
+
+        bms.status(dataOf(STATUS_13));
+        CHECK_EQUAL(2, bms.notifications);
+        CHECK_EQUAL(13, bms.getNumberOfCells());
+        // The first two cells are not connected
+        CHECK_EQUAL(0, bms.getCellVoltageOrNull(1));
+        CHECK_EQUAL(41, bms.getCellVoltageOrNull(3));
+        CHECK_EQUAL(455, bms.getModuleVoltage());
+        CHECK_EQUAL(0, bms.getModuleChargeCurrent());
+        CHECK_EQUAL(0, bms.getStateOfCharge());
+        CHECK_EQUAL(5000, bms.getModuleTotalCapacity());
+        CHECK_EQUAL(2971, bms.getTemperatureOfSensorOrNull(1));
+    }
+
+    void testRecordNumberIsNotDecoded()
+    {
+        // A record number that starts with the state of charge register ID and a valid value
+        TestJkBms bms;
+        Bytes data = dataOf(STATUS_14);
+        data[data.size() - 4] = 0x85;
+        data[data.size() - 3] = 0x63;
+        bms.status(data);
+        CHECK_EQUAL(1, bms.notifications);
+        CHECK_EQUAL(15, bms.getStateOfCharge());
+    }
+
+    void testInvalidFramesAreDropped()
+    {
+        TestJkBms bms;
+        const Bytes status = dataOf(STATUS_14);
+
+        // A register ID of unknown width right after the cell voltages
+        Bytes unknown = status;
+        unknown[44] = 0x7A;
+        bms.status(unknown);
+        // The last register cut off, its value runs into the record number
+        bms.status(Bytes(status.begin(), status.end() - 5));
+        // Shorter than a record number
+        bms.status({0x79, 0x00});
+        // The length of the cell voltages is part of the record number
+        bms.status({0x79, 0x2A, 0x01, 0x0E, 0xED});
+        // Too many cells
+        Bytes cells = status;
+        cells[1] = 3 * 25;
+        bms.status(cells);
+        CHECK_EQUAL(0, bms.notifications);
+        CHECK(!bms.hasFullUpdate());
+
+        // Complete, but without the registers the replies are built from
+        bms.status({0x79, 0x03, 0x01, 0x0E, 0xED, 0x83, 0x14, 0xEF, 0x00, 0x00, 0x00, 0x00});
+        CHECK_EQUAL(0, bms.notifications);
+        CHECK(!bms.hasFullUpdate());
+
+        bms.status(status);
+        CHECK_EQUAL(1, bms.notifications);
+        CHECK(bms.hasFullUpdate());
+    }
+
+    void testFastUpdate()
+    {
+        esp_log_level_set("*", ESP_LOG_NONE);
+        Bus bus;
+        bus.bms.set_update_interval_bounds(1, 1);
+        bus.bms.set_full_update_interval(60000);
+        bus.registerReplies = {
+            {0x83, {0x83, 0x15, 0x00, 0x00, 0x00, 0x00, 0x00}},
+            {0x84, {0x84, 0x80, 0x64, 0x00, 0x00, 0x00, 0x00}},
+            {0x85, {0x85, 0x50, 0x00, 0x00, 0x00, 0x00}},
+            {0x8B, {0x8B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+            // A record number that holds a register ID
+            {0x8C, {0x8C, 0x00, 0x07, 0x85, 0x63, 0x00, 0x00}},
+        };
+
+        bus.serve(1);
+        CHECK_EQUAL(1, bus.bms.notifications);
+        CHECK_EQUAL(15, bus.bms.getStateOfCharge());
+
+        // 53.76 V, 1.00 A charging, 80 %, read one register at a time
+        bus.serve(2);
+        CHECK_EQUAL(2, bus.bms.notifications);
+        CHECK_EQUAL(537, bus.bms.getModuleVoltage());
+        CHECK_EQUAL(10, bus.bms.getModuleChargeCurrent());
+        CHECK_EQUAL(80, bus.bms.getStateOfCharge());
+        CHECK_EQUAL(14, bus.bms.getNumberOfCells());
+
+        // A register cut off drops the fast update, nothing is published until the next complete one
+        bus.registerReplies[0x85] = {0x85};
+        const size_t notifications = bus.bms.notifications;
+        const int64_t untilUs = esp_timer_get_time() + 50 * 1000;
+        while (esp_timer_get_time() < untilUs)
+        {
+            bus.modbus.loop();
+            bus.answer();
+        }
+        CHECK_EQUAL(notifications, bus.bms.notifications);
+    }
+
+    void testFastUpdateFallback()
+    {
+        Bus bus;
+        bus.modbus.set_response_timeout(2);
+        bus.modbus.set_max_attempts(1);
+        bus.bms.set_update_interval_bounds(1, 1);
+        bus.bms.set_full_update_interval(60000);
+        bus.serve(1);
+        CHECK(bus.bms.hasFullUpdate());
+
+        // The single register reads go unanswered: one failure only drops the fast update
+        bus.serveUntil([&]() { return bus.bms.fastUpdateFailures() == 1; });
+        CHECK_EQUAL(1, bus.bms.fastUpdateFailures());
+        CHECK(bus.bms.fastUpdatesSupported());
+        bus.serveUntil([&]() { return !bus.bms.fastUpdatesSupported(); });
+        CHECK(!bus.bms.fastUpdatesSupported());
+        CHECK_EQUAL(3, bus.bms.fastUpdateFailures());
+
+        // The next full update probes them again, a single failure stops them until the one after
+        bus.serve(2);
+        CHECK(bus.bms.fastUpdatesSupported());
+        bus.serveUntil([&]() { return !bus.bms.fastUpdatesSupported(); });
+        CHECK(!bus.bms.fastUpdatesSupported());
+        CHECK_EQUAL(2, bus.bms.notifications);
+
+        // Once the registers are answered, the probe after the next full update brings them back for good
+        bus.registerReplies = {
+            {0x83, {0x83, 0x15, 0x00, 0x00, 0x00, 0x00, 0x00}},
+            {0x84, {0x84, 0x80, 0x64, 0x00, 0x00, 0x00, 0x00}},
+            {0x85, {0x85, 0x50, 0x00, 0x00, 0x00, 0x00}},
+            {0x8B, {0x8B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+            {0x8C, {0x8C, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00}},
+        };
+        bus.serve(4);
+        CHECK_EQUAL(80, bus.bms.getStateOfCharge());
+        CHECK(bus.bms.fastUpdatesSupported());
+        CHECK_EQUAL(0, bus.bms.fastUpdateFailures());
+
+        // A reply that refuses the register stops them right away
+        Bus refusing;
+        refusing.bms.set_update_interval_bounds(1, 1);
+        refusing.bms.set_full_update_interval(60000);
+        refusing.registerReplies = {{0x83, {0x00, 0x00, 0x00, 0x00, 0x00}}};
+        refusing.serve(1);
+        refusing.serveUntil([&]() { return !refusing.bms.fastUpdatesSupported(); });
+        CHECK(!refusing.bms.fastUpdatesSupported());
+        CHECK_EQUAL(0, refusing.bms.fastUpdateFailures());
+    }
+} // namespace
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    testCapturedFrames();
+    testRecordNumberIsNotDecoded();
+    testInvalidFramesAreDropped();
+    testFastUpdate();
+    testFastUpdateFallback();
+    return host_test::result();
+}
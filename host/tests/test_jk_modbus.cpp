@@ -0,0 +1,306 @@
+// JkModbus receive path: captured status frames, noise and false starts before a frame, corrupt lengths and
+// checksums, frames handed over in pieces, frames that wrap around the end of the ring buffer, requests
+// echoed back by the adapter and packs told apart by their terminal number, in replies and uploads.
+
+#include <random>
+#include <vector>
+#include "host_test.h"
+#include "esp_log.h"
+#include "jk_captured_frames.h"
+#include "memory_uart_component.h"
+#include "esphome/components/jk_modbus/jk_modbus.h"
+
+using namespace esphome::jk_modbus;
+using host_test::MemoryUARTComponent;
+
+namespace
+{
+    using Bytes = std::vector<uint8_t>;
+
+    struct Frame
+    {
+        uint8_t function;
+        Bytes data;
+    };
+
+    class RecordingDevice : public JkModbusDevice
+    {
+    public:
+        std::vector<Frame> frames;
+
+        void on_jk_modbus_data(const uint8_t &function, const JkFrameView &data) override
+        {
+            frames.push_back({function, Bytes(data.begin(), data.end())});
+        }
+        // Not polled, the frames come from the test
+        void update() override {}
+
+        bool uploading() const { return uploading_; }
+    };
+
+    class TestJkModbus : public JkModbus
+    {
+    public:
+        uint16_t buffered() const { return rx_len_; }
+    };
+
+    struct Bus
+    {
+        MemoryUARTComponent uart;
+        TestJkModbus modbus;
+        RecordingDevice device;
+
+        Bus()
+        {
+            modbus.set_uart_parent(&uart);
+            device.set_parent(&modbus);
+            device.set_address(0x4E);
+            modbus.register_device(&device);
+        }
+
+        void receive(const Bytes &bytes)
+        {
+            uart.receive(bytes);
+            // loop() stops after a few hundred bytes between frames
+            while (uart.available() > 0)
+                modbus.loop();
+        }
+    };
+
+    Bytes captured(const uint8_t *frame, size_t size) { return Bytes(frame, frame + size); }
+
+    // The data a device is handed: from after the frame type to the end sequence, the record number included
+    Bytes dataOf(const Bytes &frame) { return Bytes(frame.begin() + 11, frame.end() - 5); }
+
+    Bytes reply(uint8_t function, const Bytes &data, uint32_t terminalNumber = 0)
+    {
+        Bytes frame{0x4E, 0x57, 0x00, 0x00, (uint8_t)(terminalNumber >> 24), (uint8_t)(terminalNumber >> 16),
+                    (uint8_t)(terminalNumber >> 8), (uint8_t)terminalNumber, function, 0x00, 0x01};
+        // Record number, end sequence and the 2 unused bytes
+        const Bytes tail{0x00, 0x00, 0x00, 0x00, 0x68, 0x00, 0x00};
+        frame.reserve(frame.size() + data.size() + tail.size() + 2);
+        frame.insert(frame.end(), data.begin(), data.end());
+        frame.insert(frame.end(), tail.begin(), tail.end());
+        frame[2] = (uint8_t)(frame.size() >> 8);
+        frame[3] = (uint8_t)frame.size();
+        uint16_t checksum = 0;
+        for (uint8_t byte : frame)
+            checksum += byte;
+        frame.push_back((uint8_t)(checksum >> 8));
+        frame.push_back((uint8_t)checksum);
+        return frame;
+    }
+
+    Bytes concat(std::initializer_list<Bytes> parts)
+    {
+        Bytes stream;
+        for (const Bytes &part : parts)
+            stream.insert(stream.end(), part.begin(), part.end());
+        return stream;
+    }
+
+    const Bytes STATUS_14 = captured(host_test::JK_STATUS_FRAME_14_CELLS, sizeof(host_test::JK_STATUS_FRAME_14_CELLS));
+    const Bytes STATUS_13 = captured(host_test::JK_STATUS_FRAME_13_CELLS, sizeof(host_test::JK_STATUS_FRAME_13_CELLS));
+
+    void testCapturedFrames()
+    {
+        Bus bus;
+        bus.receive(concat({STATUS_14, STATUS_13}));
+
+        CHECK_EQUAL(2, bus.device.frames.size());
+        CHECK(bus.device.frames.size() == 2 && bus.device.frames[0].function == 0x06 &&
+              bus.device.frames[0].data == dataOf(STATUS_14) && bus.device.frames[1].data == dataOf(STATUS_13));
+        CHECK_EQUAL(0, bus.modbus.buffered());
+    }
+
+    void testNoiseAndFalseStarts()
+    {
+        Bus bus;
+        // Start bytes in the noise, one of them with a valid length that takes in the start of the real frame
+        const Bytes noise{0x11, 0x4E, 0x4E, 0x4E, 0x57, 0x00, 0x13, 0x00, 0x4E, 0x57};
+
+        bus.receive(concat({noise, STATUS_14, noise, STATUS_13}));
+        CHECK_EQUAL(2, bus.device.frames.size());
+        CHECK(bus.device.frames.size() == 2 && bus.device.frames[0].data == dataOf(STATUS_14) &&
+              bus.device.frames[1].data == dataOf(STATUS_13));
+        // The noise after the last frame is still buffered, it could be the start of the next one
+        bus.receive(STATUS_14);
+        CHECK_EQUAL(3, bus.device.frames.size());
+        CHECK_EQUAL(0, bus.modbus.buffered());
+    }
+
+    void testCorruptLength()
+    {
+        Bus bus;
+        // Longer than any frame, shorter than a request and a length that points into the next frame
+        const Bytes tooLong{0x4E, 0x57, 0xFF, 0xFF};
+        const Bytes tooShort{0x4E, 0x57, 0x00, 0x05};
+        const Bytes wrong{0x4E, 0x57, 0x00, 0x20, 0x00};
+
+        bus.receive(concat({tooLong, STATUS_14, tooShort, STATUS_13, wrong, STATUS_14}));
+        CHECK_EQUAL(3, bus.device.frames.size());
+        CHECK_EQUAL(0, bus.modbus.buffered());
+    }
+
+    void testBadChecksum()
+    {
+        Bus bus;
+        Bytes corrupt = STATUS_14;
+        corrupt[100] ^= 0x01;
+        Bytes badEnd = STATUS_13;
+        badEnd[badEnd.size() - 5] = 0x69;
+
+        bus.receive(concat({corrupt, STATUS_13, badEnd, STATUS_14}));
+        CHECK_EQUAL(2, bus.device.frames.size());
+        CHECK(bus.device.frames.size() == 2 && bus.device.frames[0].data == dataOf(STATUS_13) &&
+              bus.device.frames[1].data == dataOf(STATUS_14));
+        CHECK_EQUAL(0, bus.modbus.buffered());
+    }
+
+    void testFrameInPieces()
+    {
+        for (size_t chunkSize : {1, 7, 64})
+        {
+            Bus bus;
+            bus.uart.setChunkSize(chunkSize);
+            // Each piece is checked when it arrives, the frame is complete with its last byte
+            for (size_t i = 0; i < STATUS_14.size(); i += chunkSize)
+            {
+                CHECK_EQUAL(0, bus.device.frames.size());
+                const size_t end = std::min(STATUS_14.size(), i + chunkSize);
+                bus.receive(Bytes(STATUS_14.begin() + i, STATUS_14.begin() + end));
+            }
+            CHECK_EQUAL(1, bus.device.frames.size());
+            CHECK(bus.device.frames.size() == 1 && bus.device.frames[0].data == dataOf(STATUS_14));
+        }
+    }
+
+    void testFramesAcrossTheRingEnd()
+    {
+        Bus bus;
+        // Frames of different lengths with noise in between, so they start at every offset of the ring
+        for (int round = 0; round < 300; round++)
+        {
+            const Bytes frame = round % 3 == 0 ? STATUS_14 : reply(0x03, Bytes(1 + round % 40, (uint8_t)round));
+            bus.receive(concat({Bytes(round % 7, 0x4E), frame}));
+            CHECK(bus.device.frames.size() == (size_t)round + 1 && bus.device.frames.back().data == dataOf(frame));
+        }
+    }
+
+    void testEchoedRequest()
+    {
+        // An adapter that echoes what is sent, the request comes back before the reply
+        Bus bus;
+        CHECK(bus.device.read_registers(0x06, 0x00));
+        const Bytes request = bus.uart.written();
+        CHECK_EQUAL(21, request.size());
+
+        bus.receive(request);
+        CHECK(bus.modbus.is_busy());
+        CHECK_EQUAL(0, bus.device.frames.size());
+
+        bus.receive(STATUS_14);
+        CHECK(!bus.modbus.is_busy());
+        CHECK(bus.device.is_online());
+        CHECK_EQUAL(1, bus.device.frames.size());
+    }
+
+    void testTerminalNumbers()
+    {
+        MemoryUARTComponent uart;
+        JkModbus modbus;
+        modbus.set_uart_parent(&uart);
+        RecordingDevice first, second, any, same;
+        for (RecordingDevice *device : {&first, &second, &any, &same})
+        {
+            device->set_parent(&modbus);
+            device->set_address(0x4E);
+        }
+        first.set_terminal_number(1);
+        second.set_terminal_number(2);
+        same.set_terminal_number(2);
+        CHECK(modbus.register_device(&first));
+        CHECK(modbus.register_device(&second));
+        // Frames for a pack that takes any terminal number, or the same one, can't be told apart
+        CHECK(!modbus.register_device(&any));
+        CHECK(!modbus.register_device(&same));
+
+        CHECK(first.read_registers(0x06, 0x00));
+        const Bytes &request = uart.written();
+        CHECK(request.size() == 21 && request[4] == 0x00 && request[5] == 0x00 && request[6] == 0x00 &&
+              request[7] == 0x01);
+
+        // The reply of the other pack doesn't complete the request, it goes to the other pack
+        uart.receive(reply(0x06, {0x79, 0x00}, 2));
+        while (uart.available() > 0)
+            modbus.loop();
+        CHECK(modbus.is_busy());
+        CHECK_EQUAL(0, first.frames.size());
+        CHECK_EQUAL(1, second.frames.size());
+
+        uart.receive(reply(0x06, {0x79, 0x00}, 1));
+        while (uart.available() > 0)
+            modbus.loop();
+        CHECK(!modbus.is_busy());
+        CHECK_EQUAL(1, first.frames.size());
+        CHECK_EQUAL(0, any.frames.size() + same.frames.size());
+
+        // An upload only stops the polling of the pack that sent it
+        Bytes upload = reply(0x06, {0x79, 0x00}, 2);
+        upload[10] = 0x02;
+        upload[upload.size() - 1] += 1;
+        uart.receive(upload);
+        while (uart.available() > 0)
+            modbus.loop();
+        CHECK(second.uploading());
+        CHECK(!first.uploading());
+        CHECK_EQUAL(1, first.frames.size());
+        CHECK_EQUAL(2, second.frames.size());
+    }
+
+    void testRandomStream()
+    {
+        // Whatever comes before it, a frame is found once the bytes of a false start that takes it in are in
+        Bus bus;
+        std::mt19937 random(1);
+        size_t injected = 0;
+        size_t found = 0;
+        for (int i = 0; i < 200000; i++)
+        {
+            // A third of the noise is made of start bytes, to start many false frames
+            const uint32_t kind = random() % 6;
+            Bytes noise{kind == 0 ? (uint8_t)0x4E : kind == 1 ? (uint8_t)0x57 : (uint8_t)random()};
+            if (i % 1000 == 999)
+            {
+                noise.insert(noise.end(), STATUS_13.begin(), STATUS_13.end());
+                injected++;
+            }
+            bus.receive(noise);
+        }
+        // Enough bytes for the longest frame a false start can claim
+        bus.receive(Bytes(700, 0x00));
+
+        for (const Frame &frame : bus.device.frames)
+            found += frame.data == dataOf(STATUS_13);
+        printf("random stream: %zu of %zu injected frames found, %zu found in the noise\n", found, injected,
+               bus.device.frames.size() - found);
+        CHECK_EQUAL(injected, found);
+        CHECK_EQUAL(0, bus.modbus.buffered());
+    }
+} // namespace
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    testCapturedFrames();
+    testNoiseAndFalseStarts();
+    testCorruptLength();
+    testBadChecksum();
+    testFrameInPieces();
+    testFramesAcrossTheRingEnd();
+    testEchoedRequest();
+    testTerminalNumbers();
+    testRandomStream();
+    return host_test::result();
+}
@@ -0,0 +1,79 @@
+// ModbusCrc16 against the bit by bit reference. Built once per MODBUS_CRC16_SLICES value, every build also
+// checks all the sliced variants.
+
+#include <random>
+#include "host_test.h"
+#include "sdkconfig.h"
+
+// The engine choice of the Kconfig menu
+#undef CONFIG_BMS_LIB_CRC16_TABLE
+#if TEST_CRC16_SLICES == 8
+#define CONFIG_BMS_LIB_CRC16_SLICE_BY_8 1
+#elif TEST_CRC16_SLICES == 4
+#define CONFIG_BMS_LIB_CRC16_SLICE_BY_4 1
+#else
+#define CONFIG_BMS_LIB_CRC16_TABLE 1
+#endif
+
+#include "modbus_crc16.h"
+
+using namespace sdragos::mppsolar;
+
+// The check value of CRC-16/MODBUS, and a request of the PIP inverter with the CRC it sends
+static constexpr std::array<uint8_t, 9> CHECK_INPUT{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+static_assert(ModbusCrc16::compute(CHECK_INPUT) == 0x4B37, "CRC-16/MODBUS check value");
+static_assert(ModbusCrc16::withCrc(std::array<uint8_t, 6>{0x01, 0x03, 0x00, 0x70, 0x00, 0x01})[6] == 0x85, "CRC low byte");
+static_assert(ModbusCrc16::withCrc(std::array<uint8_t, 6>{0x01, 0x03, 0x00, 0x70, 0x00, 0x01})[7] == 0xD1, "CRC high byte");
+
+template <size_t Slices>
+static void checkSlicedMatchesBitwise(std::mt19937 &random)
+{
+    uint8_t data[300];
+    for (int run = 0; run < 5000; run++)
+    {
+        // Every length up to 2 blocks is covered, then random ones
+        const size_t len = run < 2 * Slices + 1 ? run : random() % sizeof(data);
+        const uint16_t initial = run % 2 == 0 ? ModbusCrc16::INITIAL_VALUE : (uint16_t)random();
+        for (size_t i = 0; i < len; i++)
+            data[i] = (uint8_t)random();
+
+        CHECK_EQUAL(ModbusCrc16::updateBitwise(initial, data, len), ModbusCrc16::updateSliced<Slices>(initial, data, len));
+    }
+}
+
+static void checkConfiguredEngine(std::mt19937 &random)
+{
+    uint8_t frame[258];
+    for (int run = 0; run < 2000; run++)
+    {
+        const size_t len = random() % (sizeof(frame) - 2);
+        for (size_t i = 0; i < len; i++)
+            frame[i] = (uint8_t)random();
+
+        const uint16_t expected = ModbusCrc16::updateBitwise(ModbusCrc16::INITIAL_VALUE, frame, len);
+        CHECK_EQUAL(expected, ModbusCrc16::compute(frame, len));
+
+        // One byte at a time, like the frame parser accumulates it
+        uint16_t crc = ModbusCrc16::INITIAL_VALUE;
+        for (size_t i = 0; i < len; i++)
+            crc = ModbusCrc16::update(crc, frame[i]);
+        CHECK_EQUAL(expected, crc);
+
+        // A frame followed by its CRC checks to 0
+        frame[len] = (uint8_t)expected;
+        frame[len + 1] = (uint8_t)(expected >> 8);
+        CHECK_EQUAL(0, ModbusCrc16::compute(frame, len + 2));
+    }
+}
+
+int main()
+{
+    std::mt19937 random(1);
+    checkSlicedMatchesBitwise<1>(random);
+    checkSlicedMatchesBitwise<4>(random);
+    checkSlicedMatchesBitwise<8>(random);
+    checkConfiguredEngine(random);
+
+    CHECK_EQUAL(TEST_CRC16_SLICES, MODBUS_CRC16_SLICES);
+    return host_test::result();
+}
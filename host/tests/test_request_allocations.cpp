@@ -0,0 +1,97 @@
+// Steady-state request handling does not allocate: the handler answers a few polling cycles of the simulated
+// inverter, and takes new data snapshots in between, with operator new counting.
+
+#include <cstdlib>
+#include <new>
+#include "host_test.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "bms_lib_protocol_uart_handler.h"
+#include "bms_lib_protocol_mock_data_adapter.h"
+#include "mpp_inverter_simulator.h"
+#include "virtual_uart_component.h"
+
+using namespace sdragos::mppsolar;
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *memory = malloc(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+namespace
+{
+    // Publishes a snapshot on request, like JkBms does after each BMS read
+    class SnapshotDataAdapter : public BMSLibProtocolMockDataAdapter
+    {
+    public:
+        void publishSnapshot() { notifyDataUpdated(); }
+    };
+
+    VirtualUARTComponent *newVirtualUart()
+    {
+        VirtualUARTComponent *uart = new VirtualUARTComponent();
+        uart->set_baud_rate(115200);
+        uart->set_data_bits(8);
+        uart->set_stop_bits(1);
+        uart->set_parity(UARTParityOptions::UART_CONFIG_PARITY_NONE);
+        return uart;
+    }
+
+    // Both ends run in this thread, the handler waits out the inter-frame silence before replying
+    void serve(MPPInverterSimulator &inverter, BMSLibProtocolUARTHandler &handler, SnapshotDataAdapter &dataAdapter, uint32_t replies)
+    {
+        const int64_t deadlineUs = esp_timer_get_time() + 10 * 1000 * 1000;
+        while (inverter.getStats().replies < replies && esp_timer_get_time() < deadlineUs)
+        {
+            inverter.loop();
+            handler.loop();
+            if (inverter.getStats().requests % 10 == 0)
+                dataAdapter.publishSnapshot();
+        }
+    }
+} // namespace
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    VirtualUARTComponent *handlerUart = newVirtualUart();
+    VirtualUARTComponent *inverterUart = newVirtualUart();
+    VirtualUARTComponent::connect(handlerUart, inverterUart);
+
+    MPPInverterSimulator inverter(inverterUart);
+    inverter.setRequestGapMs(0);
+
+    SnapshotDataAdapter dataAdapter;
+    BMSLibProtocolUARTHandler handler(handlerUart);
+    handler.setDataAdapter(&dataAdapter);
+    handler.setFrameCompletionMode(FrameCompletionMode::InterFrameSilence);
+    handler.setRequestPredictionEnabled(true);
+    handler.setup();
+
+    // The first cycle trains the predictor
+    serve(inverter, handler, dataAdapter, 50);
+
+    const size_t allocationsBefore = allocations;
+    const uint32_t repliesBefore = inverter.getStats().replies;
+    serve(inverter, handler, dataAdapter, repliesBefore + 200);
+    const uint32_t replies = inverter.getStats().replies - repliesBefore;
+
+    printf("%lu replies, %zu allocations\n", (unsigned long)replies, allocations - allocationsBefore);
+    // The setup allocates, so the counting operator new is the one in use
+    CHECK(allocationsBefore > 0);
+    CHECK_EQUAL(200, replies);
+    CHECK_EQUAL(0, inverter.getStats().missedReplies);
+    CHECK_EQUAL(0, inverter.getStats().invalidReplies);
+    CHECK(handler.getStats().predictedReplies > 0);
+    CHECK_EQUAL(0, allocations - allocationsBefore);
+    return host_test::result();
+}
@@ -0,0 +1,103 @@
+// BMSLibProtocolRequestPredictor: learning a polling cycle, keeping the learned successor over a single out of
+// order request, requests that hash to the same set of the table and broken sequences.
+
+#include <vector>
+#include "host_test.h"
+#include "bms_lib_protocol_request_predictor.h"
+
+using namespace sdragos::mppsolar;
+
+namespace
+{
+    class TestPredictor : public BMSLibProtocolRequestPredictor
+    {
+    public:
+        using BMSLibProtocolRequestPredictor::indexOf;
+
+        // True when the request after request is predicted to be expected
+        bool predicts(const ReadRequest &request, const ReadRequest &expected)
+        {
+            observe(request);
+            ReadRequest next{};
+            return predictNext(next) && next == expected;
+        }
+    };
+
+    ReadRequest read(uint16_t address) { return ReadRequest{address, 1}; }
+
+    // A request of the given set, from the addresses at or after from
+    ReadRequest inSet(size_t set, uint16_t from)
+    {
+        for (uint16_t address = from;; address++)
+        {
+            if (TestPredictor::indexOf(read(address)) == set)
+                return read(address);
+        }
+    }
+
+    void testPollingCycle()
+    {
+        TestPredictor predictor;
+        const std::vector<ReadRequest> cycle{read(0x0070), read(0x0071), read(0x0072), read(0x0073), read(0x0074)};
+        for (int round = 0; round < 2; round++)
+        {
+            for (const ReadRequest &request : cycle)
+                predictor.observe(request);
+        }
+
+        size_t predicted = 0;
+        for (size_t i = 0; i < cycle.size(); i++)
+            predicted += predictor.predicts(cycle[i], cycle[(i + 1) % cycle.size()]);
+        CHECK_EQUAL(cycle.size(), predicted);
+
+        // A single out of order request does not unlearn the cycle
+        predictor.observe(read(0x0070));
+        predictor.observe(read(0x0033));
+        predictor.breakSequence();
+        CHECK(predictor.predicts(read(0x0070), read(0x0071)));
+    }
+
+    void testCollidingRequests()
+    {
+        // Two requests of the same set, each followed by one of a set of its own
+        const ReadRequest first = read(0x0070);
+        const size_t set = TestPredictor::indexOf(first);
+        const ReadRequest second = inSet(set, first.dataAddress + 1);
+        const ReadRequest third = inSet(set, second.dataAddress + 1);
+        const size_t ways = BMSLibProtocolRequestPredictor::WAYS;
+        const ReadRequest afterFirst = inSet((set + 2 * ways) % BMSLibProtocolRequestPredictor::TABLE_SIZE, 0x0010);
+        const ReadRequest afterSecond = inSet((set + 4 * ways) % BMSLibProtocolRequestPredictor::TABLE_SIZE, 0x0010);
+
+        TestPredictor predictor;
+        const std::vector<ReadRequest> cycle{first, afterFirst, second, afterSecond};
+        for (int round = 0; round < 3; round++)
+        {
+            for (const ReadRequest &request : cycle)
+                predictor.observe(request);
+        }
+
+        // Both are predicted on every round, neither evicts the other
+        for (int round = 0; round < 3; round++)
+        {
+            CHECK(predictor.predicts(first, afterFirst));
+            predictor.observe(afterFirst);
+            CHECK(predictor.predicts(second, afterSecond));
+            predictor.observe(afterSecond);
+        }
+
+        // A third one of the set, seen once, does not take a slot the cycle uses
+        predictor.observe(third);
+        predictor.observe(afterSecond);
+        predictor.breakSequence();
+        CHECK(predictor.predicts(first, afterFirst));
+        predictor.breakSequence();
+        CHECK(predictor.predicts(second, afterSecond));
+    }
+} // namespace
+
+int main()
+{
+    testPollingCycle();
+    testCollidingRequests();
+    return host_test::result();
+}
@@ -9,9 +9,14 @@ namespace jk_bms {
 
 //static const char *const TAG = "jk_bms";
 
-static const uint8_t MAX_NO_RESPONSE_COUNT = 5;
+// Changes between two status frames that make the polling fall back to the minimum interval
+static const float UPDATE_CURRENT_STEP = 2.0f;               // A
+static const float UPDATE_DELTA_CELL_VOLTAGE_STEP = 0.005f;  // V
+// Growth of the interval per steady status frame, in percent
+static const uint32_t UPDATE_INTERVAL_GROWTH = 150;
 
 static const uint8_t FUNCTION_READ_ALL = 0x06;
+static const uint8_t FUNCTION_READ_REGISTER = 0x03;
 static const uint8_t ADDRESS_READ_ALL = 0x00;
 static const uint8_t WRITE_REGISTER = 0x02;
 
@@ -48,25 +53,96 @@ static const char *const BATTERY_TYPES[BATTERY_TYPES_SIZE] = {
     "Lithium Titanate",        // 0x02
 };
 
-void JkBms::on_jk_modbus_data(const uint8_t &function, const std::vector<uint8_t> &data) {
-  this->reset_online_status_tracker_();
-
+void JkBms::on_jk_modbus_data(const uint8_t &function, const jk_modbus::JkFrameView &data) {
   if (function == FUNCTION_READ_ALL) {
     this->on_status_data_(data);
     return;
   }
 
+  if (function == FUNCTION_READ_REGISTER) {
+    this->on_register_data_(data);
+    return;
+  }
+
   ESP_LOGW(TAG, "Invalid size (%zu) for JK BMS frame!", data.size());
 }
 
-void JkBms::on_status_data_(const std::vector<uint8_t> &data) {
-  auto jk_get_16bit = [&](size_t i) -> uint16_t { return (uint16_t(data[i + 0]) << 8) | (uint16_t(data[i + 1]) << 0); };
-  auto jk_get_32bit = [&](size_t i) -> uint32_t {
-    return (uint32_t(jk_get_16bit(i + 0)) << 16) | (uint32_t(jk_get_16bit(i + 2)) << 0);
-  };
-
-  ESP_LOGI(TAG, "Status frame received.");
+// Registers of the status data, in the order the BMS sends them. The widths let the decoder step over registers it
+// doesn't store and find the next ID without knowing where a register sits in the frame.
+constexpr JkBms::StatusRegister JkBms::STATUS_REGISTERS[] = {
+    {0x79, 0, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Cell voltages
+    {0x80, 2, RegisterType::TEMPERATURE, 1.0f, &JkBms::power_tube_temperature_sensor_},  // °C
+    {0x81, 2, RegisterType::TEMPERATURE, 1.0f, &JkBms::temperature_sensor_1_sensor_},    // Battery box, °C
+    {0x82, 2, RegisterType::TEMPERATURE, 1.0f, &JkBms::temperature_sensor_2_sensor_},    // Battery, °C
+    {0x83, 2, RegisterType::UNSIGNED, 0.01f, &JkBms::total_voltage_sensor_},             // V
+    {0x84, 2, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Current
+    {0x85, 1, RegisterType::UNSIGNED, 1.0f, &JkBms::capacity_remaining_sensor_},         // %
+    {0x86, 1, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Temperature sensors
+    {0x87, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::charging_cycles_sensor_},
+    {0x89, 4, RegisterType::UNSIGNED, 1.0f, &JkBms::total_charging_cycle_capacity_sensor_},
+    {0x8A, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::battery_strings_sensor_},
+    {0x8B, 2, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Warnings
+    {0x8C, 2, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Status
+    {0x8E, 2, RegisterType::UNSIGNED, 0.01f, &JkBms::total_voltage_overvoltage_protection_sensor_},   // V
+    {0x8F, 2, RegisterType::UNSIGNED, 0.01f, &JkBms::total_voltage_undervoltage_protection_sensor_},  // V
+    {0x90, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::cell_voltage_overvoltage_protection_sensor_},   // V
+    {0x91, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::cell_voltage_overvoltage_recovery_sensor_},     // V
+    {0x92, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::cell_voltage_overvoltage_delay_sensor_},          // s
+    {0x93, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::cell_voltage_undervoltage_protection_sensor_},  // V
+    {0x94, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::cell_voltage_undervoltage_recovery_sensor_},    // V
+    {0x95, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::cell_voltage_undervoltage_delay_sensor_},         // s
+    {0x96, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::cell_pressure_difference_protection_sensor_},   // V
+    {0x97, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::discharging_overcurrent_protection_sensor_},      // A
+    {0x98, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::discharging_overcurrent_delay_sensor_},           // s
+    {0x99, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::charging_overcurrent_protection_sensor_},         // A
+    {0x9A, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::charging_overcurrent_delay_sensor_},              // s
+    {0x9B, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::balance_starting_voltage_sensor_},              // V
+    {0x9C, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::balance_opening_pressure_difference_sensor_},   // V
+    {0x9D, 1, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Active balance switch
+    {0x9E, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::power_tube_temperature_protection_sensor_},       // °C
+    {0x9F, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::power_tube_temperature_recovery_sensor_},         // °C
+    {0xA0, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::temperature_sensor_temperature_protection_sensor_},  // °C
+    {0xA1, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::temperature_sensor_temperature_recovery_sensor_},    // °C
+    {0xA2, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::temperature_sensor_temperature_difference_protection_sensor_},
+    {0xA3, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::charging_high_temperature_protection_sensor_},     // °C
+    {0xA4, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::discharging_high_temperature_protection_sensor_},  // °C
+    {0xA5, 2, RegisterType::SIGNED, 1.0f, &JkBms::charging_low_temperature_protection_sensor_},        // °C
+    {0xA6, 2, RegisterType::SIGNED, 1.0f, &JkBms::charging_low_temperature_recovery_sensor_},          // °C
+    {0xA7, 2, RegisterType::SIGNED, 1.0f, &JkBms::discharging_low_temperature_protection_sensor_},     // °C
+    {0xA8, 2, RegisterType::SIGNED, 1.0f, &JkBms::discharging_low_temperature_recovery_sensor_},       // °C
+    {0xA9, 1, RegisterType::SKIPPED, 1.0f, nullptr},                                  // Battery string setting
+    {0xAA, 4, RegisterType::UNSIGNED, 1.0f, &JkBms::total_battery_capacity_setting_sensor_},           // Ah
+    {0xAB, 1, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Charging MOS switch
+    {0xAC, 1, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Discharging MOS switch
+    {0xAD, 2, RegisterType::UNSIGNED, 0.001f, &JkBms::current_calibration_sensor_},   // A
+    {0xAE, 1, RegisterType::UNSIGNED, 1.0f, &JkBms::device_address_sensor_},
+    {0xAF, 1, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Battery type
+    {0xB0, 2, RegisterType::UNSIGNED, 1.0f, &JkBms::sleep_wait_time_sensor_},         // s
+    {0xB1, 1, RegisterType::UNSIGNED, 1.0f, &JkBms::alarm_low_volume_sensor_},        // %
+    {0xB2, 10, RegisterType::SPECIAL, 1.0f, nullptr},                                 // Password
+    {0xB3, 1, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Dedicated charger switch
+    {0xB4, 8, RegisterType::SPECIAL, 1.0f, nullptr},                                  // Device ID code
+    {0xB5, 4, RegisterType::SKIPPED, 1.0f, nullptr},                                  // Date of manufacture
+    {0xB6, 4, RegisterType::SPECIAL, 1.0f, nullptr},                                  // System working minutes
+    {0xB7, 15, RegisterType::SPECIAL, 1.0f, nullptr},                                 // Software version
+    {0xB8, 1, RegisterType::SKIPPED, 1.0f, nullptr},                                  // Start current calibration
+    {0xB9, 4, RegisterType::UNSIGNED, 1.0f, &JkBms::actual_battery_capacity_sensor_},  // Ah
+    {0xBA, 24, RegisterType::SPECIAL, 1.0f, nullptr},                                 // Manufacturer ID
+    {0xC0, 1, RegisterType::UNSIGNED, 1.0f, &JkBms::protocol_version_sensor_},
+};
+constexpr uint8_t JkBms::STATUS_REGISTERS_SIZE = sizeof(JkBms::STATUS_REGISTERS) / sizeof(JkBms::STATUS_REGISTERS[0]);
+
+constexpr std::array<uint8_t, 256> JkBms::make_status_register_index_() {
+  std::array<uint8_t, 256> index{};
+  for (auto &position : index)
+    position = NO_STATUS_REGISTER;
+  for (uint8_t i = 0; i < STATUS_REGISTERS_SIZE; i++)
+    index[STATUS_REGISTERS[i].id] = i;
+  return index;
+}
+constexpr std::array<uint8_t, 256> JkBms::STATUS_REGISTER_INDEX = JkBms::make_status_register_index_();
 
+void JkBms::on_status_data_(const jk_modbus::JkFrameView &data) {
   // Status request
   // -> 0x4E 0x57 0x00 0x13 0x00 0x00 0x00 0x00 0x06 0x03 0x00 0x00 0x00 0x00 0x00 0x00 0x68 0x00 0x00 0x01 0x29
   //
@@ -75,24 +151,190 @@ void JkBms::on_status_data_(const std::vector<uint8_t> &data) {
   //
   // *Data*
   //
-  // Address Content: Description      Decoded content                         Coeff./Unit
-  // 0x79: Individual Cell voltage
-  // 0x2A: Cell count               42 / 3 bytes = 14 cells
-  // 0x01 0x0E 0xED: Cell 1         3821 * 0.001 = 3.821V                        0.001 V
-  // 0x02 0x0E 0xFA: Cell 2         3834 * 0.001 = 3.834V                        0.001 V
-  // 0x03 0x0E 0xF7: Cell 3         3831 * 0.001 = 3.831V                        0.001 V
-  // 0x04 0x0E 0xEC: Cell 4         ...                                          0.001 V
-  // 0x05 0x0E 0xF8: Cell 5         ...                                          0.001 V
-  // 0x06 0x0E 0xFA: Cell 6         ...                                          0.001 V
-  // 0x07 0x0E 0xF1: Cell 7         ...                                          0.001 V
-  // 0x08 0x0E 0xF8: Cell 8         ...                                          0.001 V
-  // 0x09 0x0E 0xE3: Cell 9         ...                                          0.001 V
-  // 0x0A 0x0E 0xFA: Cell 10        ...                                          0.001 V
-  // 0x0B 0x0E 0xF1: Cell 11        ...                                          0.001 V
-  // 0x0C 0x0E 0xFB: Cell 12        ...                                          0.001 V
-  // 0x0D 0x0E 0xFB: Cell 13        ...                                          0.001 V
-  // 0x0E 0x0E 0xF2: Cell 14        3826 * 0.001 = 3.826V                        0.001 V
-  uint8_t cells = data[1] / 3;
+  // A register ID followed by its value, for every register in STATUS_REGISTERS:
+  // 0x79 0x2A 0x01 0x0E 0xED ...: Cell voltages, 42 / 3 bytes = 14 cells, cell 1 3821 * 0.001 = 3.821V
+  // 0x80 0x00 0x1D: Power tube temperature 29°C
+  // ...
+  // 0xC0 0x01: Protocol version number
+  //
+  // 00 00 00 00 68 00 00 54 D1: Record number and end of frame
+
+  ESP_LOGI(TAG, "Status frame received.");
+
+  if (data.empty() || data[0] != 0x79) {
+    ESP_LOGW(TAG, "Invalid status frame (%zu bytes)!", data.size());
+    return;
+  }
+
+  uint64_t decoded = 0;
+  if (!this->decode_registers_(data, decoded)) {
+    ESP_LOGW(TAG, "Status frame not decoded completely, dropped.");
+    return;
+  }
+  for (uint8_t id : ESSENTIAL_STATUS_REGISTERS) {
+    if ((decoded & (1ULL << STATUS_REGISTER_INDEX[id])) == 0) {
+      ESP_LOGW(TAG, "Register 0x%02X missing from the status frame, dropped.", id);
+      return;
+    }
+  }
+
+  last_successful_read_data_ = (uint32_t)(esp_timer_get_time() / 1000ULL);
+  // Uploaded data arrives without update() being called, which otherwise tracks this
+  has_recent_data_ = true;
+  this->last_full_update_ = last_successful_read_data_;
+  this->has_full_update_ = true;
+  ESP_LOGI(TAG, "Updated.");
+
+  // Fast updates that failed are tried again once after each full update, a firmware without them costs one
+  // unanswered request per full update interval
+  if (!this->fast_updates_supported_) {
+    ESP_LOGD(TAG, "Probing fast updates again.");
+    this->fast_updates_supported_ = true;
+    this->fast_update_failures_ = FAST_UPDATE_MAX_FAILURES - 1;
+  }
+
+  this->adapt_update_interval_();
+
+  this->notifyDataUpdated();
+}
+
+bool JkBms::decode_registers_(const jk_modbus::JkFrameView &data, uint64_t &decoded) {
+  static_assert(STATUS_REGISTERS_SIZE <= 64, "A register without a bit in decoded.");
+
+  auto get_16bit = [](const uint8_t *value) -> uint16_t { return (uint16_t(value[0]) << 8) | (uint16_t(value[1]) << 0); };
+  auto get_32bit = [&](const uint8_t *value) -> uint32_t {
+    return (uint32_t(get_16bit(value + 0)) << 16) | (uint32_t(get_16bit(value + 2)) << 0);
+  };
+
+  // The current and the capacity derived from the state of charge depend on registers that come after them
+  const uint8_t *raw_current = nullptr;
+  bool has_total_battery_capacity_setting = false;
+
+  // The record number is not a register, a byte of it that matches an ID would be decoded as one
+  if (data.size() < RECORD_NUMBER_SIZE) {
+    ESP_LOGW(TAG, "Frame data too short (%zu bytes)!", data.size());
+    return false;
+  }
+  const uint8_t *const end = data.end() - RECORD_NUMBER_SIZE;
+  const uint8_t *at = data.begin();
+  bool complete = true;
+  while (at < end) {
+    const uint8_t id = at[0];
+    const uint8_t position = STATUS_REGISTER_INDEX[id];
+    if (position == NO_STATUS_REGISTER) {
+      // Without its width the rest can't be decoded
+      ESP_LOGW(TAG, "Unknown register 0x%02X, %d bytes not decoded!", id, (int) (end - at));
+      complete = false;
+      break;
+    }
+
+    const StatusRegister &reg = STATUS_REGISTERS[position];
+    const uint8_t *value = at + 1;
+    // The cell voltages start with their own length, without it the register is cut off
+    const size_t width = id == 0x79 ? (value < end ? 1 + value[0] : 1) : reg.width;
+    if ((size_t) (end - value) < width) {
+      ESP_LOGW(TAG, "Register 0x%02X is cut off!", id);
+      complete = false;
+      break;
+    }
+    at = value + width;
+    decoded |= 1ULL << position;
+    if (id == 0xAA)
+      has_total_battery_capacity_setting = true;
+
+    switch (reg.type) {
+      case RegisterType::UNSIGNED: {
+        const uint32_t raw = width == 1 ? value[0] : width == 2 ? get_16bit(value) : get_32bit(value);
+        this->*reg.target = (float) raw * reg.scale;
+        continue;
+      }
+      case RegisterType::SIGNED:
+        this->*reg.target = (float) (int16_t) get_16bit(value) * reg.scale;
+        continue;
+      case RegisterType::TEMPERATURE:
+        // --->  99 = 99°C, 100 = 100°C, 101 = -1°C, 140 = -40°C
+        this->*reg.target = get_temperature_(get_16bit(value));
+        continue;
+      case RegisterType::SKIPPED:
+        continue;
+      case RegisterType::SPECIAL:
+        break;
+    }
+
+    switch (id) {
+      case 0x79: {
+        // 0x79 0x2A 0x01 0x0E 0xED ...: Cell count in bytes, then cell number and voltage of every cell
+        const uint8_t cells = value[0] / 3;
+        if (cells > MAX_CELLS) {
+          ESP_LOGW(TAG, "Too many cells (%u)!", cells);
+          return false;
+        }
+        this->update_cell_voltages_(value + 1, cells);
+        break;
+      }
+      case 0x84:
+        // 0x84 0x80 0xD0: Current data                                32976                     0.01 A
+        raw_current = value;
+        break;
+      case 0x86:
+        this->temperature_sensors_sensor_ = value[0];
+        break;
+      case 0x8B:
+        // Bit 0 low capacity warning, bits 1-13 alarms, see error_bits_to_string_()
+        this->update_errors_(get_16bit(value));
+        break;
+      case 0x8C:
+        // Bit 0: Charging enabled, Bit 1: Discharging enabled, Bit 2: Balancer enabled, Bit 3: Battery dropped(?)
+        this->update_operation_mode_(get_16bit(value));
+        break;
+      case 0x9D:
+        this->balancing_switch_binary_sensor_ = (bool) value[0];
+        break;
+      case 0xAB:
+        this->charging_switch_binary_sensor_ = (bool) value[0];
+        break;
+      case 0xAC:
+        this->discharging_switch_binary_sensor_ = (bool) value[0];
+        break;
+      case 0xAF:
+        this->battery_type_text_sensor_ = value[0] < BATTERY_TYPES_SIZE ? BATTERY_TYPES[value[0]] : "Unknown";
+        break;
+      case 0xB2:
+        this->password_text_sensor_ = std::string(value, value + width);
+        break;
+      case 0xB3:
+        this->dedicated_charger_switch_binary_sensor_ = (bool) value[0];
+        break;
+      case 0xB4:
+        this->device_type_text_sensor_ = std::string(value, value + width);
+        break;
+      case 0xB6:
+        // 0xB6 0x00 0x00 0xE2 0x00: System working hours, in minutes
+        this->total_runtime_sensor_ = (float) get_32bit(value) * 0.0166666666667;
+        this->total_runtime_formatted_text_sensor_ = format_total_runtime_(get_32bit(value) * 60);
+        break;
+      case 0xB7:
+        this->software_version_text_sensor_ = std::string(value, value + width);
+        break;
+      case 0xBA:
+        this->manufacturer_text_sensor_ = std::string(value, value + width);
+        break;
+    }
+  }
+
+  if (raw_current != nullptr)
+    this->update_current_(get_16bit(raw_current), (uint8_t) this->protocol_version_sensor_);
+  if (has_total_battery_capacity_setting)
+    this->capacity_remaining_derived_sensor_ =
+        this->total_battery_capacity_setting_sensor_ * (this->capacity_remaining_sensor_ * 0.01f);
+
+  this->temperature_sensors_[0].temperature_sensor_ = this->temperature_sensor_1_sensor_;
+  this->temperature_sensors_[1].temperature_sensor_ = this->temperature_sensor_2_sensor_;
+
+  return complete;
+}
+
+void JkBms::update_cell_voltages_(const uint8_t *cell_data, uint8_t cells) {
   cell_count_ = cells;
 
   float min_cell_voltage = 100.0f;
@@ -101,7 +343,9 @@ void JkBms::on_status_data_(const std::vector<uint8_t> &data) {
   uint8_t min_voltage_cell = 0;
   uint8_t max_voltage_cell = 0;
   for (uint8_t i = 0; i < cells; i++) {
-    float cell_voltage = (float) jk_get_16bit(i * 3 + 3) * 0.001f;
+    // Cell number, then the voltage in mV
+    const uint8_t *cell = cell_data + i * 3;
+    float cell_voltage = (float) ((uint16_t(cell[1]) << 8) | cell[2]) * 0.001f;
     average_cell_voltage = average_cell_voltage + cell_voltage;
     if (cell_voltage < min_cell_voltage) {
       min_cell_voltage = cell_voltage;
@@ -113,7 +357,8 @@ void JkBms::on_status_data_(const std::vector<uint8_t> &data) {
     }
     this->cells_[i].cell_voltage_sensor_ = cell_voltage;
   }
-  average_cell_voltage = average_cell_voltage / cells;
+  if (cells > 0)
+    average_cell_voltage = average_cell_voltage / cells;
 
   this->min_cell_voltage_sensor_ = min_cell_voltage;
   this->max_cell_voltage_sensor_ = max_cell_voltage;
@@ -121,297 +366,143 @@ void JkBms::on_status_data_(const std::vector<uint8_t> &data) {
   this->min_voltage_cell_sensor_ = (float) min_voltage_cell;
   this->delta_cell_voltage_sensor_ = max_cell_voltage - min_cell_voltage;
   this->average_cell_voltage_sensor_ = average_cell_voltage;
+}
 
-  uint16_t offset = data[1] + 3;
+void JkBms::on_register_data_(const jk_modbus::JkFrameView &data) {
+  // The reply holds the register that was asked for, followed by the record number. The current is decoded
+  // with the protocol version of the last full update.
+  if (this->fast_register_index_ >= FAST_UPDATE_REGISTERS_SIZE) {
+    ESP_LOGW(TAG, "Register 0x%02X outside of a fast update!", data.size() > 0 ? data[0] : 0);
+    return;
+  }
+  // A reply without the register asked for is the firmware refusing the read, which won't change
+  if (data.size() == 0 || data[0] != FAST_UPDATE_REGISTERS[this->fast_register_index_]) {
+    ESP_LOGW(TAG, "Register 0x%02X refused, using full updates only.",
+             FAST_UPDATE_REGISTERS[this->fast_register_index_]);
+    this->fast_updates_supported_ = false;
+    this->fast_register_index_ = FAST_UPDATE_REGISTERS_SIZE;
+    return;
+  }
+  uint64_t decoded = 0;
+  if (!this->decode_registers_(data, decoded)) {
+    ESP_LOGW(TAG, "Register 0x%02X not decoded, fast update dropped.", data[0]);
+    this->fast_register_index_ = FAST_UPDATE_REGISTERS_SIZE;
+    return;
+  }
 
-  // 0x80 0x00 0x1D: Read power tube temperature                 29°C                      1.0 °C
-  // --->  99 = 99°C, 100 = 100°C, 101 = -1°C, 140 = -40°C
-  this->power_tube_temperature_sensor_ = get_temperature_(jk_get_16bit(offset + 3 * 0));
+  // The bus is free again once the reply is in, the next register is asked for right away
+  if (++this->fast_register_index_ < FAST_UPDATE_REGISTERS_SIZE) {
+    this->read_registers(FUNCTION_READ_REGISTER, FAST_UPDATE_REGISTERS[this->fast_register_index_]);
+    return;
+  }
 
-  // 0x81 0x00 0x1E: Read the temperature in the battery box     30°C                      1.0 °C
-  this->temperature_sensor_1_sensor_ = get_temperature_(jk_get_16bit(offset + 3 * 1));
-  this->temperature_sensors_[0].temperature_sensor_ = this->temperature_sensor_1_sensor_;
+  last_successful_read_data_ = (uint32_t)(esp_timer_get_time() / 1000ULL);
+  has_recent_data_ = true;
+  this->fast_update_failures_ = 0;
+  ESP_LOGI(TAG, "Fast update done.");
 
-  // 0x82 0x00 0x1C: Read battery temperature                    28°C                      1.0 °C
-  this->temperature_sensor_2_sensor_ = get_temperature_(jk_get_16bit(offset + 3 * 2));
-  this->temperature_sensors_[1].temperature_sensor_ = this->temperature_sensor_2_sensor_;
+  this->adapt_update_interval_();
 
-  // 0x83 0x14 0xEF: Total battery voltage                       5359 * 0.01 = 53.59V      0.01 V
-  float total_voltage = (float) jk_get_16bit(offset + 3 * 3) * 0.01f;
-  this->total_voltage_sensor_ = total_voltage;
+  this->notifyDataUpdated();
+}
 
-  // 0x84 0x80 0xD0: Current data                                32976                     0.01 A
-  // this->publish_state_(this->current_sensor_, get_current_(jk_get_16bit(offset + 3 * 4), 0x01) * 0.01f);
-  float current = get_current_(jk_get_16bit(offset + 3 * 4), data[offset + 84 + 3 * 45]) * 0.01f;
+void JkBms::update_current_(uint16_t raw_current, uint8_t protocol_version) {
+  float current = get_current_(raw_current, protocol_version) * 0.01f;
   this->current_sensor_ = current;
   this->charging_current_sensor_ = std::max(0.0f, current);
   this->discharging_current_sensor_ = std::abs(std::min(0.0f, current));
 
-  float power = total_voltage * current;
+  float power = this->total_voltage_sensor_ * current;
   this->power_sensor_ = power;
   this->charging_power_sensor_ = std::max(0.0f, power);               // 500W vs 0W -> 500W
   this->discharging_power_sensor_ = std::abs(std::min(0.0f, power));  // -500W vs 0W -> 500W
+}
 
-  // 0x85 0x0F: Battery remaining capacity                       15 %
-  uint8_t raw_battery_remaining_capacity = data[offset + 3 * 5];
-  this->capacity_remaining_sensor_ = (float) raw_battery_remaining_capacity;
-
-  // 0x86 0x02: Number of battery temperature sensors             2                        1.0  count
-  this->temperature_sensors_sensor_ = data[offset + 2 + 3 * 5];
-
-  // 0x87 0x00 0x04: Number of battery cycles                     4                        1.0  count
-  this->charging_cycles_sensor_ = (float) jk_get_16bit(offset + 4 + 3 * 5);
-
-  // 0x89 0x00 0x00 0x00 0x00: Total battery cycle capacity
-  this->total_charging_cycle_capacity_sensor_ = (float) jk_get_32bit(offset + 4 + 3 * 6);
-
-  // 0x8A 0x00 0x0E: Total number of battery strings             14                        1.0  count
-  this->battery_strings_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 7);
-
-  // 0x8B 0x00 0x00: Battery warning message                     0000 0000 0000 0000
-  //
-  // Bit 0    Low capacity                                1 (alarm), 0 (normal)    warning
-  // Bit 1    Power tube overtemperature                  1 (alarm), 0 (normal)    alarm
-  // Bit 2    Charging overvoltage                        1 (alarm), 0 (normal)    alarm
-  // Bit 3    Discharging undervoltage                    1 (alarm), 0 (normal)    alarm
-  // Bit 4    Battery over temperature                    1 (alarm), 0 (normal)    alarm
-  // Bit 5    Charging overcurrent                        1 (alarm), 0 (normal)    alarm
-  // Bit 6    Discharging overcurrent                     1 (alarm), 0 (normal)    alarm
-  // Bit 7    Cell pressure difference                    1 (alarm), 0 (normal)    alarm
-  // Bit 8    Overtemperature alarm in the battery box    1 (alarm), 0 (normal)    alarm
-  // Bit 9    Battery low temperature                     1 (alarm), 0 (normal)    alarm
-  // Bit 10   Cell overvoltage                            1 (alarm), 0 (normal)    alarm
-  // Bit 11   Cell undervoltage                           1 (alarm), 0 (normal)    alarm
-  // Bit 12   309_A protection                            1 (alarm), 0 (normal)    alarm
-  // Bit 13   309_A protection                            1 (alarm), 0 (normal)    alarm
-  // Bit 14   Reserved
-  // Bit 15   Reserved
-  //
-  // Examples:
-  // 0x0001 = 00000000 00000001: Low capacity alarm
-  // 0x0002 = 00000000 00000010: MOS tube over-temperature alarm
-  // 0x0003 = 00000000 00000011: Low capacity alarm AND power tube over-temperature alarm
-  uint16_t raw_errors_bitmask = jk_get_16bit(offset + 6 + 3 * 8);
+void JkBms::update_errors_(uint16_t raw_errors_bitmask) {
   errors_bitmask_sensor_ = raw_errors_bitmask;
   this->errors_text_sensor_ = this->error_bits_to_string_(raw_errors_bitmask);
+}
 
-  // 0x8C 0x00 0x07: Battery status information                  0000 0000 0000 0111
-  // Bit 0: Charging enabled        1 (on), 0 (off)
-  // Bit 1: Discharging enabled     1 (on), 0 (off)
-  // Bit 2: Balancer enabled        1 (on), 0 (off)
-  // Bit 3: Battery dropped(?)      1 (normal), 0 (offline)
-  // Bit 4...15: Reserved
-
-  // Example: 0000 0000 0000 0111 -> Charging + Discharging + Balancer enabled
-  uint16_t raw_modes_bitmask = jk_get_16bit(offset + 6 + 3 * 9);
+void JkBms::update_operation_mode_(uint16_t raw_modes_bitmask) {
   this->operation_mode_bitmask_sensor_ = raw_modes_bitmask;
 
   this->operation_mode_text_sensor_ = this->mode_bits_to_string_(raw_modes_bitmask);
   this->charging_binary_sensor_ = check_bit_(raw_modes_bitmask, 1);
   this->discharging_binary_sensor_ = check_bit_(raw_modes_bitmask, 2);
   this->balancing_binary_sensor_ = check_bit_(raw_modes_bitmask, 4);
+}
 
-  // 0x8E 0x16 0x26: Total voltage overvoltage protection        5670 * 0.01 = 56.70V     0.01 V
-  this->total_voltage_overvoltage_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 10) * 0.01f;
-
-  // 0x8F 0x10 0xAE: Total voltage undervoltage protection       4270 * 0.01 = 42.70V     0.01 V
-  this->total_voltage_undervoltage_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 11) * 0.01f;
-
-  // 0x90 0x0F 0xD2: Cell overvoltage protection voltage         4050 * 0.001 = 4.050V     0.001 V
-  this->cell_voltage_overvoltage_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 12) * 0.001f;
-
-  // 0x91 0x0F 0xA0: Cell overvoltage recovery voltage           4000 * 0.001 = 4.000V     0.001 V
-  this->cell_voltage_overvoltage_recovery_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 13) * 0.001f;
-
-  // 0x92 0x00 0x05: Cell overvoltage protection delay            5s                         1.0 s
-  this->cell_voltage_overvoltage_delay_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 14);
-
-  // 0x93 0x0B 0xEA: Cell undervoltage protection voltage        3050 * 0.001 = 3.050V     0.001 V
-  this->cell_voltage_undervoltage_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 15) * 0.001f;
-
-  // 0x94 0x0C 0x1C: Cell undervoltage recovery voltage          3100 * 0.001 = 3.100V     0.001 V
-  this->cell_voltage_undervoltage_recovery_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 16) * 0.001f;
-
-  // 0x95 0x00 0x05: Cell undervoltage protection delay           5s                         1.0 s
-  this->cell_voltage_undervoltage_delay_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 17);
-
-  // 0x96 0x01 0x2C: Cell pressure difference protection value    300 * 0.001 = 0.300V     0.001 V     0.000-1.000V
-  this->cell_pressure_difference_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 18) * 0.001f;
-
-  // 0x97 0x00 0x07: Discharge overcurrent protection value       7A                         1.0 A
-  this->discharging_overcurrent_protection_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 19);
-
-  // 0x98 0x00 0x03: Discharge overcurrent delay                  3s                         1.0 s
-  this->discharging_overcurrent_delay_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 20);
-
-  // 0x99 0x00 0x05: Charging overcurrent protection value        5A                         1.0 A
-  this->charging_overcurrent_protection_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 21);
-
-  // 0x9A 0x00 0x05: Charge overcurrent delay                     5s                         1.0 s
-  this->charging_overcurrent_delay_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 22);
-
-  // 0x9B 0x0C 0xE4: Balanced starting voltage                   3300 * 0.001 = 3.300V     0.001 V
-  this->balance_starting_voltage_sensor_ = (float) jk_get_16bit(offset + 6 + 3 * 23) * 0.001f;
-
-  // 0x9C 0x00 0x08: Balanced opening pressure difference           8 * 0.001 = 0.008V     0.001 V     0.01-1V
-  this->balance_opening_pressure_difference_sensor_ =
-                       (float) jk_get_16bit(offset + 6 + 3 * 24) * 0.001f;
-
-  // 0x9D 0x01: Active balance switch                              1 (on)                     Bool     0 (off), 1 (on)
-  this->balancing_switch_binary_sensor_ = (bool) data[offset + 6 + 3 * 25];
-
-  // 0x9E 0x00 0x5A: Power tube temperature protection value                90°C            1.0 °C     0-100°C
-  this->power_tube_temperature_protection_sensor_ = (float) jk_get_16bit(offset + 8 + 3 * 25);
-
-  // 0x9F 0x00 0x46: Power tube temperature recovery value                  70°C            1.0 °C     0-100°C
-  this->power_tube_temperature_recovery_sensor_ = (float) jk_get_16bit(offset + 8 + 3 * 26);
-
-  // 0xA0 0x00 0x64: Temperature protection value in the battery box       100°C            1.0 °C     40-100°C
-  this->temperature_sensor_temperature_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 8 + 3 * 27);
-
-  // 0xA1 0x00 0x64: Temperature recovery value in the battery box         100°C            1.0 °C     40-100°C
-  this->temperature_sensor_temperature_recovery_sensor_ =
-                       (float) jk_get_16bit(offset + 8 + 3 * 28);
-
-  // 0xA2 0x00 0x14: Battery temperature difference protection value        20°C            1.0 °C     5-10°C
-  this->temperature_sensor_temperature_difference_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 8 + 3 * 29);
-
-  // 0xA3 0x00 0x46: Battery charging high temperature protection value     70°C            1.0 °C     0-100°C
-  this->charging_high_temperature_protection_sensor_ = (float) jk_get_16bit(offset + 8 + 3 * 30);
-
-  // 0xA4 0x00 0x46: Battery discharge high temperature protection value    70°C            1.0 °C     0-100°C
-  this->discharging_high_temperature_protection_sensor_ =
-                       (float) jk_get_16bit(offset + 8 + 3 * 31);
-
-  // 0xA5 0xFF 0xEC: Charging low temperature protection value             -20°C            1.0 °C     -45...25°C
-  this->charging_low_temperature_protection_sensor_ =
-                       (float) (int16_t) jk_get_16bit(offset + 8 + 3 * 32);
-
-  // 0xA6 0xFF 0xF6: Charging low temperature protection recovery value    -10°C            1.0 °C     -45...25°C
-  this->charging_low_temperature_recovery_sensor_ =
-                       (float) (int16_t) jk_get_16bit(offset + 8 + 3 * 33);
-
-  // 0xA7 0xFF 0xEC: Discharge low temperature protection value            -20°C            1.0 °C     -45...25°C
-  this->discharging_low_temperature_protection_sensor_ =
-                       (float) (int16_t) jk_get_16bit(offset + 8 + 3 * 34);
-
-  // 0xA8 0xFF 0xF6: Discharge low temperature protection recovery value   -10°C            1.0 °C     -45...25°C
-  this->discharging_low_temperature_recovery_sensor_ =
-                       (float) (int16_t) jk_get_16bit(offset + 8 + 3 * 35);
-
-  // 0xA9 0x0E: Battery string setting                                      14              1.0 count
-  // this->publish_state_(this->battery_string_setting_sensor_, (float) data[offset + 8 + 3 * 36]);
-  // 0xAA 0x00 0x00 0x02 0x30: Total battery capacity setting              560 Ah           1.0 Ah
-  uint32_t raw_total_battery_capacity_setting = jk_get_32bit(offset + 10 + 3 * 36);
-  this->total_battery_capacity_setting_sensor_ = (float) raw_total_battery_capacity_setting;
-  this->capacity_remaining_derived_sensor_ =
-                       (float) (raw_total_battery_capacity_setting * (raw_battery_remaining_capacity * 0.01f));
-
-  // 0xAB 0x01: Charging MOS tube switch                                     1 (on)         Bool       0 (off), 1 (on)
-  this->charging_switch_binary_sensor_ = (bool) data[offset + 15 + 3 * 36];
-
-  // 0xAC 0x01: Discharge MOS tube switch                                    1 (on)         Bool       0 (off), 1 (on)
-  this->discharging_switch_binary_sensor_ = (bool) data[offset + 17 + 3 * 36];
-
-  // 0xAD 0x04 0x11: Current calibration                       1041mA * 0.001 = 1.041A     0.001 A     0.1-2.0A
-  this->current_calibration_sensor_ = (float) jk_get_16bit(offset + 19 + 3 * 36) * 0.001f;
-
-  // 0xAE 0x01: Protection board address                                     1              1.0
-  this->device_address_sensor_ = (float) data[offset + 19 + 3 * 37];
+void JkBms::set_update_interval_bounds(uint32_t min_update_interval, uint32_t max_update_interval) {
+  this->min_update_interval_ = min_update_interval;
+  this->max_update_interval_ = std::max(min_update_interval, max_update_interval);
+  this->set_update_interval(min_update_interval);
+}
 
-  // 0xAF 0x01: Battery Type                                                 1              1.0
-  // ---> 0 (lithium iron phosphate), 1 (ternary), 2 (lithium titanate)
-  uint8_t raw_battery_type = data[offset + 21 + 3 * 37];
-  if (raw_battery_type < BATTERY_TYPES_SIZE) {
-    this->battery_type_text_sensor_ = BATTERY_TYPES[raw_battery_type];
-  } else {
-    this->battery_type_text_sensor_ = "Unknown";
+void JkBms::adapt_update_interval_() {
+  const bool moving = !this->has_previous_status_ || this->errors_bitmask_sensor_ != 0 ||
+                      this->errors_bitmask_sensor_ != this->previous_errors_bitmask_ ||
+                      std::abs(this->current_sensor_ - this->previous_current_) >= UPDATE_CURRENT_STEP ||
+                      std::abs(this->delta_cell_voltage_sensor_ - this->previous_delta_cell_voltage_) >=
+                          UPDATE_DELTA_CELL_VOLTAGE_STEP;
+
+  this->has_previous_status_ = true;
+  this->previous_current_ = this->current_sensor_;
+  this->previous_delta_cell_voltage_ = this->delta_cell_voltage_sensor_;
+  this->previous_errors_bitmask_ = this->errors_bitmask_sensor_;
+
+  // Back to the fastest rate right away, slowing down takes a few steady frames
+  uint32_t update_interval = this->min_update_interval_;
+  if (!moving)
+    update_interval = std::min(this->max_update_interval_, this->get_update_interval() * UPDATE_INTERVAL_GROWTH / 100);
+
+  if (update_interval != this->get_update_interval()) {
+    ESP_LOGD(TAG, "Update interval %lu ms", (unsigned long) update_interval);
+    this->set_update_interval(update_interval);
   }
-
-  // 0xB0 0x00 0x0A: Sleep waiting time                                      10s            1.0 s
-  this->sleep_wait_time_sensor_ = (float) jk_get_16bit(offset + 23 + 3 * 37);
-
-  // 0xB1 0x14: Low volume alarm                                             20%            1.0 %      0-80%
-  this->alarm_low_volume_sensor_ = (float) data[offset + 23 + 3 * 38];
-
-  // 0xB2 0x31 0x32 0x33 0x34 0x35 0x36 0x00 0x00 0x00 0x00: Modify parameter password
-  this->password_text_sensor_ =
-                       std::string(data.begin() + offset + 25 + 3 * 38, data.begin() + offset + 35 + 3 * 38);
-
-  // 0xB3 0x00: Dedicated charger switch                                     1 (on)         Bool       0 (off), 1 (on)
-  this->dedicated_charger_switch_binary_sensor_ = (bool) data[offset + 36 + 3 * 38];
-
-  // 0xB4 0x49 0x6E 0x70 0x75 0x74 0x20 0x55 0x73: Device ID code
-  this->device_type_text_sensor_ =
-                       std::string(data.begin() + offset + 38 + 3 * 38, data.begin() + offset + 46 + 3 * 38);
-
-  // 0xB5 0x32 0x31 0x30 0x31: Date of manufacture
-  // 0xB6 0x00 0x00 0xE2 0x00: System working hours
-  this->total_runtime_sensor_ = (float) jk_get_32bit(offset + 46 + 3 * 40) * 0.0166666666667;
-  this->total_runtime_formatted_text_sensor_ =
-                       format_total_runtime_(jk_get_32bit(offset + 46 + 3 * 40) * 60);
-
-  // 0xB7 0x48 0x36 0x2E 0x58 0x5F 0x5F 0x53
-  //      0x36 0x2E 0x31 0x2E 0x33 0x53 0x5F 0x5F: Software version number
-  this->software_version_text_sensor_ =
-                       std::string(data.begin() + offset + 51 + 3 * 40, data.begin() + offset + 51 + 3 * 45);
-
-  // 0xB8 0x00: Whether to start current calibration
-  // 0xB9 0x00 0x00 0x00 0x00: Actual battery capacity
-  //   Firmware version >= 10.10 required
-  //   See https://github.com/syssi/esphome-jk-bms/issues/212 for details
-  this->actual_battery_capacity_sensor_ = (float) jk_get_32bit(offset + 54 + 3 * 45);
-
-  // 0xBA 0x42 0x54 0x33 0x30 0x37 0x32 0x30 0x32 0x30 0x31 0x32 0x30
-  //      0x30 0x30 0x30 0x32 0x30 0x30 0x35 0x32 0x31 0x30 0x30 0x31: Manufacturer ID naming
-  this->manufacturer_text_sensor_ =
-                       std::string(data.begin() + offset + 59 + 3 * 45, data.begin() + offset + 83 + 3 * 45);
-
-  // 0xC0 0x01: Protocol version number
-  this->protocol_version_sensor_ = (float) data[offset + 84 + 3 * 45];
-
-  // 00 00 00 00 68 00 00 54 D1: End of frame
-
-  last_successful_read_data_ = (uint32_t)(esp_timer_get_time() / 1000ULL);
-  ESP_LOGI(TAG, "Updated.");
 }
 
 void JkBms::update() {
+  this->track_recent_data_();
+
+  // In between full updates only the values that change quickly are read, one register at a time. The static
+  // settings, names and counters of the full status make up most of its bytes.
+  const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000ULL);
+  if (this->full_update_interval_ != 0 && this->fast_updates_supported_ && this->has_full_update_ &&
+      !this->enable_fake_traffic_ &&
+      now - this->last_full_update_ < this->full_update_interval_) {
+    ESP_LOGI(TAG, "Requesting fast update.");
+    this->fast_register_index_ = 0;
+    this->read_registers(FUNCTION_READ_REGISTER, FAST_UPDATE_REGISTERS[0]);
+    return;
+  }
+
   ESP_LOGI(TAG, "Requesting update.");
-  this->track_online_status_();
+  this->fast_register_index_ = FAST_UPDATE_REGISTERS_SIZE;
   this->read_registers(FUNCTION_READ_ALL, ADDRESS_READ_ALL);
 
   if (this->enable_fake_traffic_) {
+    // The fake frame stands in for a reply, whether the real request is answered or not
+    this->online_status_ = true;
     // Start: 0x4E, 0x57, 0x01, 0x1B, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01
-    this->on_jk_modbus_data(
-        FUNCTION_READ_ALL,
-        {
-            0x79, 0x2A, 0x01, 0x0E, 0xED, 0x02, 0x0E, 0xFA, 0x03, 0x0E, 0xF7, 0x04, 0x0E, 0xEC, 0x05, 0x0E, 0xF8, 0x06,
-            0x0E, 0xFA, 0x07, 0x0E, 0xF1, 0x08, 0x0E, 0xF8, 0x09, 0x0E, 0xE3, 0x0A, 0x0E, 0xFA, 0x0B, 0x0E, 0xF1, 0x0C,
-            0x0E, 0xFB, 0x0D, 0x0E, 0xFB, 0x0E, 0x0E, 0xF2, 0x80, 0x00, 0x1D, 0x81, 0x00, 0x1E, 0x82, 0x00, 0x1C, 0x83,
-            0x14, 0xEF, 0x84, 0x80, 0xD0, 0x85, 0x0F, 0x86, 0x02, 0x87, 0x00, 0x04, 0x89, 0x00, 0x00, 0x00, 0x00, 0x8A,
-            0x00, 0x0E, 0x8B, 0x00, 0x00, 0x8C, 0x00, 0x07, 0x8E, 0x16, 0x26, 0x8F, 0x10, 0xAE, 0x90, 0x0F, 0xD2, 0x91,
-            0x0F, 0xA0, 0x92, 0x00, 0x05, 0x93, 0x0B, 0xEA, 0x94, 0x0C, 0x1C, 0x95, 0x00, 0x05, 0x96, 0x01, 0x2C, 0x97,
-            0x00, 0x07, 0x98, 0x00, 0x03, 0x99, 0x00, 0x05, 0x9A, 0x00, 0x05, 0x9B, 0x0C, 0xE4, 0x9C, 0x00, 0x08, 0x9D,
-            0x01, 0x9E, 0x00, 0x5A, 0x9F, 0x00, 0x46, 0xA0, 0x00, 0x64, 0xA1, 0x00, 0x64, 0xA2, 0x00, 0x14, 0xA3, 0x00,
-            0x46, 0xA4, 0x00, 0x46, 0xA5, 0xFF, 0xEC, 0xA6, 0xFF, 0xF6, 0xA7, 0xFF, 0xEC, 0xA8, 0xFF, 0xF6, 0xA9, 0x0E,
-            0xAA, 0x00, 0x00, 0x00, 0x0E, 0xAB, 0x01, 0xAC, 0x01, 0xAD, 0x04, 0x11, 0xAE, 0x01, 0xAF, 0x01, 0xB0, 0x00,
-            0x0A, 0xB1, 0x14, 0xB2, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x00, 0x00, 0x00, 0x00, 0xB3, 0x00, 0xB4, 0x49,
-            0x6E, 0x70, 0x75, 0x74, 0x20, 0x55, 0x73, 0xB5, 0x32, 0x31, 0x30, 0x31, 0xB6, 0x00, 0x00, 0xE2, 0x00, 0xB7,
-            0x48, 0x36, 0x2E, 0x58, 0x5F, 0x5F, 0x53, 0x36, 0x2E, 0x31, 0x2E, 0x33, 0x53, 0x5F, 0x5F, 0xB8, 0x00, 0xB9,
-            0x00, 0x00, 0x00, 0x00, 0xBA, 0x42, 0x54, 0x33, 0x30, 0x37, 0x32, 0x30, 0x32, 0x30, 0x31, 0x32, 0x30, 0x30,
-            0x30, 0x30, 0x32, 0x30, 0x30, 0x35, 0x32, 0x31, 0x30, 0x30, 0x31, 0xC0, 0x01,
-        });
-    // End: 0x00 0x00 0x00 0x00 0x68 0x00 0x00 0x54 0xD1
+    static const uint8_t FAKE_STATUS_DATA[] = {
+        0x79, 0x2A, 0x01, 0x0E, 0xED, 0x02, 0x0E, 0xFA, 0x03, 0x0E, 0xF7, 0x04, 0x0E, 0xEC, 0x05, 0x0E, 0xF8, 0x06,
+        0x0E, 0xFA, 0x07, 0x0E, 0xF1, 0x08, 0x0E, 0xF8, 0x09, 0x0E, 0xE3, 0x0A, 0x0E, 0xFA, 0x0B, 0x0E, 0xF1, 0x0C,
+        0x0E, 0xFB, 0x0D, 0x0E, 0xFB, 0x0E, 0x0E, 0xF2, 0x80, 0x00, 0x1D, 0x81, 0x00, 0x1E, 0x82, 0x00, 0x1C, 0x83,
+        0x14, 0xEF, 0x84, 0x80, 0xD0, 0x85, 0x0F, 0x86, 0x02, 0x87, 0x00, 0x04, 0x89, 0x00, 0x00, 0x00, 0x00, 0x8A,
+        0x00, 0x0E, 0x8B, 0x00, 0x00, 0x8C, 0x00, 0x07, 0x8E, 0x16, 0x26, 0x8F, 0x10, 0xAE, 0x90, 0x0F, 0xD2, 0x91,
+        0x0F, 0xA0, 0x92, 0x00, 0x05, 0x93, 0x0B, 0xEA, 0x94, 0x0C, 0x1C, 0x95, 0x00, 0x05, 0x96, 0x01, 0x2C, 0x97,
+        0x00, 0x07, 0x98, 0x00, 0x03, 0x99, 0x00, 0x05, 0x9A, 0x00, 0x05, 0x9B, 0x0C, 0xE4, 0x9C, 0x00, 0x08, 0x9D,
+        0x01, 0x9E, 0x00, 0x5A, 0x9F, 0x00, 0x46, 0xA0, 0x00, 0x64, 0xA1, 0x00, 0x64, 0xA2, 0x00, 0x14, 0xA3, 0x00,
+        0x46, 0xA4, 0x00, 0x46, 0xA5, 0xFF, 0xEC, 0xA6, 0xFF, 0xF6, 0xA7, 0xFF, 0xEC, 0xA8, 0xFF, 0xF6, 0xA9, 0x0E,
+        0xAA, 0x00, 0x00, 0x00, 0x0E, 0xAB, 0x01, 0xAC, 0x01, 0xAD, 0x04, 0x11, 0xAE, 0x01, 0xAF, 0x01, 0xB0, 0x00,
+        0x0A, 0xB1, 0x14, 0xB2, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x00, 0x00, 0x00, 0x00, 0xB3, 0x00, 0xB4, 0x49,
+        0x6E, 0x70, 0x75, 0x74, 0x20, 0x55, 0x73, 0xB5, 0x32, 0x31, 0x30, 0x31, 0xB6, 0x00, 0x00, 0xE2, 0x00, 0xB7,
+        0x48, 0x36, 0x2E, 0x58, 0x5F, 0x5F, 0x53, 0x36, 0x2E, 0x31, 0x2E, 0x33, 0x53, 0x5F, 0x5F, 0xB8, 0x00, 0xB9,
+        0x00, 0x00, 0x00, 0x00, 0xBA, 0x42, 0x54, 0x33, 0x30, 0x37, 0x32, 0x30, 0x32, 0x30, 0x31, 0x32, 0x30, 0x30,
+        0x30, 0x30, 0x32, 0x30, 0x30, 0x35, 0x32, 0x31, 0x30, 0x30, 0x31, 0xC0, 0x01, 0x00, 0x00, 0x00, 0x00,
+    };
+    this->on_jk_modbus_data(FUNCTION_READ_ALL, jk_modbus::JkFrameView(FAKE_STATUS_DATA, sizeof(FAKE_STATUS_DATA)));
+    // End: 0x68 0x00 0x00 0x54 0xD1
 
     // Start: 0x4E, 0x57, 0x01, 0x18, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01
     /*
@@ -439,15 +530,28 @@ void JkBms::update() {
   }
 }
 
-void JkBms::track_online_status_() {
-  if (this->no_response_count_ < MAX_NO_RESPONSE_COUNT) {
-    this->no_response_count_++;
-  }
-  if (this->no_response_count_ == MAX_NO_RESPONSE_COUNT) {
-    this->online_status_ = false;
-    this->no_response_count_++;
+void JkBms::on_jk_modbus_online_changed(bool online) {
+  // The online state comes from JkModbus, which sees each request being answered or timing out
+  this->online_status_ = online || this->enable_fake_traffic_;
+}
+
+void JkBms::on_jk_modbus_unanswered(uint8_t function, uint8_t address) {
+  if (function != FUNCTION_READ_REGISTER || this->fast_register_index_ >= FAST_UPDATE_REGISTERS_SIZE)
+    return;
+
+  // Not every firmware answers single register reads, those that don't get full updates only. A single
+  // unanswered read is as likely a disturbance on the bus.
+  this->fast_register_index_ = FAST_UPDATE_REGISTERS_SIZE;
+  if (++this->fast_update_failures_ < FAST_UPDATE_MAX_FAILURES) {
+    ESP_LOGW(TAG, "No reply to register 0x%02X, fast update dropped.", address);
+    return;
   }
-  
+  ESP_LOGW(TAG, "No reply to register 0x%02X %u times in a row, using full updates only.", address,
+           this->fast_update_failures_);
+  this->fast_updates_supported_ = false;
+}
+
+void JkBms::track_recent_data_() {
   const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000ULL);
   uint32_t elapsed = 0;
   if (now < last_successful_read_data_){
@@ -467,11 +571,6 @@ void JkBms::track_online_status_() {
   }
 }
 
-void JkBms::reset_online_status_tracker_() {
-  this->no_response_count_ = 0;
-  this->online_status_ = true;
-}
-
 std::string JkBms::error_bits_to_string_(const uint16_t mask) {
   bool first = true;
   std::string errors_list = "";
@@ -516,6 +615,12 @@ void JkBms::dump_config() {  // NOLINT(google-readability-function-size,readabil
   ESP_LOGI(TAG, "JkBms:");
   ESP_LOGI(TAG, "  Address: 0x%02X", this->address_);
   ESP_LOGI(TAG, "  Fake traffic enabled: %d", this->enable_fake_traffic_);
+  ESP_LOGI(TAG, "  Update interval: %lu ms (%lu..%lu ms)", (unsigned long) this->get_update_interval(),
+           (unsigned long) this->min_update_interval_, (unsigned long) this->max_update_interval_);
+  ESP_LOGI(TAG, "  Full update interval: %lu ms, fast updates %s", (unsigned long) this->full_update_interval_,
+           this->fast_updates_supported_ ? "supported" : "not supported");
+  ESP_LOGI(TAG, "  Online: %d, last response time: %lu us", this->is_online(),
+           (unsigned long) this->get_response_time_us());
   ESP_LOGI(TAG, "Minimum Cell Voltage %f", this->min_cell_voltage_sensor_);
   ESP_LOGI(TAG, "Maximum Cell Voltage %f", this->max_cell_voltage_sensor_);
   ESP_LOGI(TAG, "Minimum Voltage Cell %f", this->min_voltage_cell_sensor_);
@@ -613,127 +718,82 @@ void JkBms::dump_config() {  // NOLINT(google-readability-function-size,readabil
   ESP_LOGI(TAG, "Total Runtime Formatted %s", this->total_runtime_formatted_text_sensor_.c_str());
 }
 
- uint8_t *NotImplemented2Bytes(){
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = 0;
-    return reply;
- }
-
- uint8_t *NotImplemented4Bytes(){
-    auto reply = new uint8_t[4];
-    reply[0] = 0;
-    reply[1] = 0;
-    reply[2] = 0;
-    reply[3] = 0;
-    return reply;
- }
+ static const uint16_t NOT_IMPLEMENTED_2_BYTES = 0;
+ static const uint32_t NOT_IMPLEMENTED_4_BYTES = 0;
 
   // Version information
-  uint8_t *JkBms::getBMSFirmwareVersion() {
-    return NotImplemented4Bytes();
+  uint32_t JkBms::getBMSFirmwareVersion() {
+    return NOT_IMPLEMENTED_4_BYTES;
   }
-  uint8_t *JkBms::getBMSHardwareVersion() {
-    return NotImplemented4Bytes();
+  uint32_t JkBms::getBMSHardwareVersion() {
+    return NOT_IMPLEMENTED_4_BYTES;
   }
   // BMS general status
-  uint8_t *JkBms::getNumberOfCells() {
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = cell_count_; // 8 cells
-    ESP_LOGI(TAG, "Sending number of cells: %d", cell_count_);
-    return reply;
+  uint16_t JkBms::getNumberOfCells() {
+    ESP_LOGD(TAG, "Sending number of cells: %d", cell_count_);
+    return cell_count_;
   }
-  uint8_t *JkBms::getCellVoltageOrNull(size_t cellNumber) {
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = 0;
-    if (cellNumber <= cell_count_){
-      ESP_LOGI(TAG, "Sending voltage for cellNumber %d: %f", cellNumber, cells_[cellNumber-1].cell_voltage_sensor_);
+  uint16_t JkBms::getCellVoltageOrNull(size_t cellNumber) {
+    uint16_t reply = 0;
+    if (cellNumber >= 1 && cellNumber <= cell_count_){
+      ESP_LOGD(TAG, "Sending voltage for cellNumber %d: %f", cellNumber, cells_[cellNumber-1].cell_voltage_sensor_);
       float cellVoltageAdjusted =cells_[cellNumber-1].cell_voltage_sensor_ * 10;
-      reply[1] =  static_cast<uint8_t>(cellVoltageAdjusted);
+      reply = static_cast<uint16_t>(cellVoltageAdjusted);
     }
       
     return reply;
   }
-  uint8_t *JkBms::getNumberOfTemperatureSensors() {
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = temperature_sensors_sensor_;
-    ESP_LOGI(TAG, "Sending number of temperature sensors: %d", cell_count_);
-    return reply;
+  uint16_t JkBms::getNumberOfTemperatureSensors() {
+    ESP_LOGD(TAG, "Sending number of temperature sensors: %d", cell_count_);
+    return temperature_sensors_sensor_;
   };
-  uint8_t *JkBms::getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = 0;
-    if (temperatureSensorNumber <= temperature_sensors_sensor_){
-      ESP_LOGI(TAG, "Sending temperature for sensorNumber %d: %f", temperatureSensorNumber, temperature_sensors_[temperatureSensorNumber-1].temperature_sensor_);
+  uint16_t JkBms::getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) { 
+    uint16_t reply = 0;
+    if (temperatureSensorNumber >= 1 && temperatureSensorNumber <= temperature_sensors_sensor_ &&
+        temperatureSensorNumber <= MAX_TEMPERATURE_SENSORS){
+      ESP_LOGD(TAG, "Sending temperature for sensorNumber %d: %f", temperatureSensorNumber, temperature_sensors_[temperatureSensorNumber-1].temperature_sensor_);
       float temperatureAdjusted = (temperature_sensors_[temperatureSensorNumber-1].temperature_sensor_ + 273.15) * 10;
       uint16_t tempKelvin =  static_cast<uint16_t>(temperatureAdjusted);
 
-      reply[0] = (tempKelvin >> 8) & 0xFF;
-      reply[1] = tempKelvin & 0xFF;
+      reply = tempKelvin;
     }
       
     return reply;
   };
-  uint8_t *JkBms::getModuleChargeCurrent() { 
-    auto reply = new uint8_t[2];
-
+  uint16_t JkBms::getModuleChargeCurrent() { 
     float chargingCurrent = this->charging_current_sensor_ * 10;
     uint16_t chargingCurrentAdjusted = static_cast<uint16_t>(chargingCurrent);
-    reply[0] = (chargingCurrentAdjusted >> 8) & 0xFF;
-    reply[1] = chargingCurrentAdjusted & 0xFF;
 
-    ESP_LOGI(TAG, "Sending charging current: %f", chargingCurrent);
-    return reply;
+    ESP_LOGD(TAG, "Sending charging current: %f", chargingCurrent);
+    return chargingCurrentAdjusted;
   };
-  uint8_t *JkBms::getModuleDischargeCurrent() { 
-    auto reply = new uint8_t[2];
-
+  uint16_t JkBms::getModuleDischargeCurrent() { 
     float dischargingCurrent = this->discharging_current_sensor_ * 10;
     uint16_t dischargingCurrentAdjusted = static_cast<uint16_t>(dischargingCurrent);
-    reply[0] = (dischargingCurrentAdjusted >> 8) & 0xFF;
-    reply[1] = dischargingCurrentAdjusted & 0xFF;
 
-    ESP_LOGI(TAG, "Sending discharge current: %f", dischargingCurrent);
-    return reply;
+    ESP_LOGD(TAG, "Sending discharge current: %f", dischargingCurrent);
+    return dischargingCurrentAdjusted;
   };
-  uint8_t *JkBms::getModuleVoltage() { 
-    auto reply = new uint8_t[2];
-
+  uint16_t JkBms::getModuleVoltage() { 
     float totalVoltage = this->total_voltage_sensor_ * 10;
     uint16_t totalVoltageAdjusted = static_cast<uint16_t>(totalVoltage);
-    reply[0] = (totalVoltageAdjusted >> 8) & 0xFF;
-    reply[1] = totalVoltageAdjusted & 0xFF;
 
-    ESP_LOGI(TAG, "Sending total voltage: %d", totalVoltageAdjusted);
-    return reply;
+    ESP_LOGD(TAG, "Sending total voltage: %d", totalVoltageAdjusted);
+    return totalVoltageAdjusted;
   };
-  uint8_t *JkBms::getStateOfCharge() { 
-    auto reply = new uint8_t[2];
-
+  uint16_t JkBms::getStateOfCharge() { 
     float capacityRemaining = this->capacity_remaining_sensor_;
     uint16_t capacityRemainingAdjusted = static_cast<uint16_t>(capacityRemaining);
-    reply[0] = (capacityRemainingAdjusted >> 8) & 0xFF;
-    reply[1] = capacityRemainingAdjusted & 0xFF;
 
-    ESP_LOGI(TAG, "Sending capacity remaining: %f", capacityRemaining);
-    return reply;
+    ESP_LOGD(TAG, "Sending capacity remaining: %f", capacityRemaining);
+    return capacityRemainingAdjusted;
   };
-  uint8_t *JkBms::getModuleTotalCapacity() { 
-    auto reply = new uint8_t[4];
-
+  uint32_t JkBms::getModuleTotalCapacity() { 
     float totalCapacityMilliAhAdjustedFloat = this->total_battery_capacity_setting_sensor_ * 1000;
     uint32_t totalCapacityMilliAhAdjusted = static_cast<uint32_t>(totalCapacityMilliAhAdjustedFloat);
-    reply[0] = (totalCapacityMilliAhAdjusted >> 24) & 0xFF;
-    reply[1] = (totalCapacityMilliAhAdjusted >> 16) & 0xFF;
-    reply[2] = (totalCapacityMilliAhAdjusted >> 8) & 0xFF;
-    reply[3] = totalCapacityMilliAhAdjusted & 0xFF;
 
-    ESP_LOGI(TAG, "Sending total cxapacity: %lu", totalCapacityMilliAhAdjusted);
-    return reply;
+    ESP_LOGD(TAG, "Sending total cxapacity: %lu", totalCapacityMilliAhAdjusted);
+    return totalCapacityMilliAhAdjusted;
   };
 
   // BMS warning information inquiry
@@ -747,182 +807,157 @@ void JkBms::dump_config() {  // NOLINT(google-readability-function-size,readabil
   const uint8_t LibProtocolState_AboveHigherLimit = 0x02;
   const uint8_t LibProtocolState_OtherError = 0xF0;
 
-  uint8_t *JkBms::getNumberOfCellsForWarningInfo() { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getNumberOfCellsForWarningInfo() { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
-  uint8_t *JkBms::getCellPairVoltageState(size_t oddCellNumber) { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getCellPairVoltageState(size_t oddCellNumber) { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
-  uint8_t *JkBms::getNumberOfTemperatureSensorsForWarningInfo() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = temperature_sensors_sensor_;
-    ESP_LOGI(TAG, "Sending number of temperature sensors for warning info: %d", cell_count_);
-    return reply;
+  uint16_t JkBms::getNumberOfTemperatureSensorsForWarningInfo() { 
+    ESP_LOGD(TAG, "Sending number of temperature sensors for warning info: %d", cell_count_);
+    return temperature_sensors_sensor_;
   };
-  uint8_t *JkBms::getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = 0;
+  uint16_t JkBms::getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) { 
+    uint16_t reply = 0;
 
     return reply;
   };
-  uint8_t *JkBms::getModuleChargeVoltageState() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = LibProtocolState_Normal;
+  uint16_t JkBms::getModuleChargeVoltageState() { 
+    uint16_t reply = 0;
+    reply = LibProtocolState_Normal;
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_charging_overvoltage) == errors_bitmask_alarm_charging_overvoltage)
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
 
     return reply;
   };
-  uint8_t *JkBms::getModuleDischargeVoltageState() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = LibProtocolState_Normal;
+  uint16_t JkBms::getModuleDischargeVoltageState() { 
+    uint16_t reply = 0;
+    reply = LibProtocolState_Normal;
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_discharging_undervoltage) == errors_bitmask_alarm_discharging_undervoltage)
-      reply[1] |= LibProtocolState_BelowNormal;
+      reply |= LibProtocolState_BelowNormal;
     
     return reply;
   };
-  uint8_t *JkBms::getCellChargeVoltageState() { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getCellChargeVoltageState() { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
-  uint8_t *JkBms::getCellDischargeVoltageState() { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getCellDischargeVoltageState() { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
-  uint8_t *JkBms::getModuleChargeCurrentState() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = LibProtocolState_Normal;
+  uint16_t JkBms::getModuleChargeCurrentState() { 
+    uint16_t reply = 0;
+    reply = LibProtocolState_Normal;
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_charging_overcurrent) == errors_bitmask_alarm_charging_overcurrent)
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
 
     return reply;
   };
-  uint8_t *JkBms::getModuleDischargeCurrentState() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = LibProtocolState_Normal;
+  uint16_t JkBms::getModuleDischargeCurrentState() { 
+    uint16_t reply = 0;
+    reply = LibProtocolState_Normal;
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_discharging_overcurrent) == errors_bitmask_alarm_discharging_overcurrent)
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
 
     return reply;
   };
-  uint8_t *JkBms::getModuleChargeTemperatureState() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = LibProtocolState_Normal;
+  uint16_t JkBms::getModuleChargeTemperatureState() { 
+    uint16_t reply = 0;
+    reply = LibProtocolState_Normal;
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_battery_low_temperature) == errors_bitmask_alarm_battery_low_temperature)
     {
-      reply[1] |= LibProtocolState_BelowNormal;
+      reply |= LibProtocolState_BelowNormal;
       return reply;
     }
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_battery_over_temperature) == errors_bitmask_alarm_battery_over_temperature)
     {
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
       return reply;
     }
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_battery_box_overtemperature) == errors_bitmask_alarm_battery_box_overtemperature)
     {
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
       return reply;
     }
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_power_tube_over_temp) == errors_bitmask_alarm_power_tube_over_temp)
     {
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
       return reply;
     }
 
     return reply;
   };
-  uint8_t *JkBms::getModuleDischargeTemperatureState() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = LibProtocolState_Normal;
+  uint16_t JkBms::getModuleDischargeTemperatureState() { 
+    uint16_t reply = 0;
+    reply = LibProtocolState_Normal;
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_battery_over_temperature) == errors_bitmask_alarm_battery_over_temperature)
     {
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
       return reply;
     }
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_battery_box_overtemperature) == errors_bitmask_alarm_battery_box_overtemperature)
     {
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
       return reply;
     }
 
     if ((errors_bitmask_sensor_ & errors_bitmask_alarm_power_tube_over_temp) == errors_bitmask_alarm_power_tube_over_temp)
     {
-      reply[1] |= LibProtocolState_AboveHigherLimit;
+      reply |= LibProtocolState_AboveHigherLimit;
       return reply;
     }
 
     return reply;
   };
-  uint8_t *JkBms::getCellChargeTemperatureState() { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getCellChargeTemperatureState() { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
-  uint8_t *JkBms::getCellDischargeTemperatureState() { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getCellDischargeTemperatureState() { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
 
   // BMS charge and discharge information inquiry
-  uint8_t *JkBms::getChargeVoltageLimit() { 
-    auto reply = new uint8_t[2];
+  uint16_t JkBms::getChargeVoltageLimit() { 
     float chargingVoltageLimit = this->cell_voltage_overvoltage_recovery_sensor_ * this->cell_count_ * 10;
     uint16_t chargingVoltageLimitInt = static_cast<uint16_t>(chargingVoltageLimit);
-    reply[0] = (chargingVoltageLimitInt >> 8) & 0xFF;
-    reply[1] = chargingVoltageLimitInt & 0xFF;
 
-    ESP_LOGI(TAG, "Sending charge voltage limit: %d", chargingVoltageLimitInt);
-    return reply;
+    ESP_LOGD(TAG, "Sending charge voltage limit: %d", chargingVoltageLimitInt);
+    return chargingVoltageLimitInt;
   };
-  uint8_t *JkBms::getDischargeVoltageLimit() { 
-    auto reply = new uint8_t[2];
+  uint16_t JkBms::getDischargeVoltageLimit() { 
     float dischargeVoltageLimit = this->cell_voltage_undervoltage_recovery_sensor_ * this->cell_count_ * 10;
     uint16_t dischargeVoltageLimitInt = static_cast<uint16_t>(dischargeVoltageLimit);
-    reply[0] = (dischargeVoltageLimitInt >> 8) & 0xFF;
-    reply[1] = dischargeVoltageLimitInt & 0xFF;
 
-    ESP_LOGI(TAG, "Sending discharge voltage limit: %d", dischargeVoltageLimitInt);
-    return reply;
+    ESP_LOGD(TAG, "Sending discharge voltage limit: %d", dischargeVoltageLimitInt);
+    return dischargeVoltageLimitInt;
   };
-  uint8_t *JkBms::getChargeCurrentLimit() { 
-    auto reply = new uint8_t[2];
+  uint16_t JkBms::getChargeCurrentLimit() { 
     float chargingCurrentLimit = this->charging_overcurrent_protection_sensor_ * 10;
     uint16_t chargingCurrentLimitInt = static_cast<uint16_t>(chargingCurrentLimit);
-    reply[0] = (chargingCurrentLimitInt >> 8) & 0xFF;
-    reply[1] = chargingCurrentLimitInt & 0xFF;
 
-    ESP_LOGI(TAG, "Sending charging current limit: %d", chargingCurrentLimitInt);
-    return reply;
+    ESP_LOGD(TAG, "Sending charging current limit: %d", chargingCurrentLimitInt);
+    return chargingCurrentLimitInt;
   };
-  uint8_t *JkBms::getDischargeCurrentLimit() { 
-    auto reply = new uint8_t[2];
+  uint16_t JkBms::getDischargeCurrentLimit() { 
     float dischargeCurrentLimit = this->discharging_overcurrent_protection_sensor_ * 10;
     uint16_t dischargeCurrentLimitInt = static_cast<uint16_t>(dischargeCurrentLimit);
-    reply[0] = (dischargeCurrentLimitInt >> 8) & 0xFF;
-    reply[1] = dischargeCurrentLimitInt & 0xFF;
 
-    ESP_LOGI(TAG, "Sending discharge current limit: %d", dischargeCurrentLimitInt);
-    return reply;
+    ESP_LOGD(TAG, "Sending discharge current limit: %d", dischargeCurrentLimitInt);
+    return dischargeCurrentLimitInt;
   };
 
 
-  uint8_t *JkBms::getChargeDischargeStatus() { 
-    auto reply = new uint8_t[2];
-    reply[0] = 0;
-    reply[1] = 0;
+  uint16_t JkBms::getChargeDischargeStatus() { 
+    uint16_t reply = 0;
 
     const uint8_t fullChargeRequest = 8;   // 0000 1000 Set when BMS needs battery fully charged
     const uint8_t chargeImmediately2 = 16; // 0001 0000 Set when SoC is low, like 10~14%
@@ -932,42 +967,45 @@ void JkBms::dump_config() {  // NOLINT(google-readability-function-size,readabil
     
     static bool _waitUntilDischargedToLevelBeforeResumeCharge = false;
 
+    // Called for every reply cache rebuild, so once per poll: only the changes are logged at info level
     if (this->total_voltage_sensor_ >= 
         ((this->cell_voltage_overvoltage_recovery_sensor_ * this->cell_count_) - 0.1)){
+      if (!_waitUntilDischargedToLevelBeforeResumeCharge)
+        ESP_LOGI(TAG, "Maximum charge voltage reached @OVPR level set in BMS. Stopping charging until battery level drops to 26.5V or restart.");
       _waitUntilDischargedToLevelBeforeResumeCharge = true; 
-      ESP_LOGI(TAG, "Maximum charge voltage reached @OVPR level set in BMS. Stopping charging until battery level drops to 26.5V or restart.");
     }
 
     if (this->total_voltage_sensor_ <= 26.5){
+      if (_waitUntilDischargedToLevelBeforeResumeCharge)
+        ESP_LOGI(TAG, "Threshold reached for allowing charging resume @26.5V.");
       _waitUntilDischargedToLevelBeforeResumeCharge = false;
-      ESP_LOGI(TAG, "Threshold reached for allowing charging resume @26.5V.");
     }
 
     if (_waitUntilDischargedToLevelBeforeResumeCharge){
-      ESP_LOGI(TAG, "Wait until discharged to 26.5V active. Reset adapter to resume charge immediately.");
+      ESP_LOGD(TAG, "Wait until discharged to 26.5V active. Reset adapter to resume charge immediately.");
     }
 
     if (this->charging_binary_sensor_ &&
         (!_waitUntilDischargedToLevelBeforeResumeCharge) && 
         this->temperature_sensor_1_sensor_ < 35 && 
         this ->temperature_sensor_2_sensor_ < 35)
-      reply[1] |= chargeEnable;
+      reply |= chargeEnable;
     
     if (this->discharging_binary_sensor_ && this->temperature_sensor_1_sensor_ < 35 && this -> temperature_sensor_2_sensor_ < 35)
-      reply[1] |= dischargeEnable;
+      reply |= dischargeEnable;
 
     if (this->capacity_remaining_sensor_ >= 10 && this->capacity_remaining_sensor_ <= 15)
-      reply[1] |= chargeImmediately2;
+      reply |= chargeImmediately2;
 
     if (this->capacity_remaining_sensor_ < 10)
-      reply[1] |= chargeImmediately;
+      reply |= chargeImmediately;
 
     // no idea when to request full charge
 
     return reply;
   };
-  uint8_t *JkBms::getRuntimeToEmptySeconds() { 
-    return NotImplemented2Bytes();
+  uint16_t JkBms::getRuntimeToEmptySeconds() { 
+    return NOT_IMPLEMENTED_2_BYTES;
   };
 
 }  // namespace jk_bms
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include "bms_lib_protocol_data_adapter.h"
 #include "esphome/components/jk_modbus/jk_modbus.h"
 
@@ -10,31 +12,37 @@ class JkBms: public jk_modbus::JkModbusDevice, public sdragos::mppsolar::BMSLibP
  public:
 
   void set_enable_fake_traffic(bool enable_fake_traffic) { enable_fake_traffic_ = enable_fake_traffic; }
+  // Polls every min_update_interval ms while the current, the cell voltage spread or the alarms move, and
+  // slows down towards max_update_interval ms while they are steady. Equal bounds poll at a fixed interval.
+  void set_update_interval_bounds(uint32_t min_update_interval, uint32_t max_update_interval);
+  // Reads the whole status at most this often, the updates in between only read the voltage, current, state of
+  // charge and alarm registers. 0 reads the whole status on every update.
+  void set_full_update_interval(uint32_t full_update_interval) { full_update_interval_ = full_update_interval; }
 
   void dump_config();
 
-  void on_jk_modbus_data(const uint8_t &function, const std::vector<uint8_t> &data) override;
+  void on_jk_modbus_data(const uint8_t &function, const jk_modbus::JkFrameView &data) override;
 
-  void update();
+  void update() override;
 
   // Begin BMSLibProtocolDataAdapter overrides
 
   bool hasUpdatedData() override { return online_status_ && has_recent_data_; };
 
   // Version information
-  uint8_t *getBMSFirmwareVersion() override;
-  uint8_t *getBMSHardwareVersion() override;
+  uint32_t getBMSFirmwareVersion() override;
+  uint32_t getBMSHardwareVersion() override;
 
   // BMS general status
-  uint8_t *getNumberOfCells() override;
-  uint8_t *getCellVoltageOrNull(size_t cellNumber) override;
-  uint8_t *getNumberOfTemperatureSensors() override;
-  uint8_t *getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) override;
-  uint8_t *getModuleChargeCurrent() override;
-  uint8_t *getModuleDischargeCurrent() override;
-  uint8_t *getModuleVoltage() override;
-  uint8_t *getStateOfCharge() override;
-  uint8_t *getModuleTotalCapacity() override;
+  uint16_t getNumberOfCells() override;
+  uint16_t getCellVoltageOrNull(size_t cellNumber) override;
+  uint16_t getNumberOfTemperatureSensors() override;
+  uint16_t getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) override;
+  uint16_t getModuleChargeCurrent() override;
+  uint16_t getModuleDischargeCurrent() override;
+  uint16_t getModuleVoltage() override;
+  uint16_t getStateOfCharge() override;
+  uint32_t getModuleTotalCapacity() override;
 
   // BMS warning information inquiry
   // All reply with 2 bytes and only the LSB is set to one of:
@@ -42,28 +50,28 @@ class JkBms: public jk_modbus::JkModbusDevice, public sdragos::mppsolar::BMSLibP
   //      0x01 - Below normal
   //      0x02 - Above higher limit
   //      0xF0 - Other error
-  uint8_t *getNumberOfCellsForWarningInfo() override;
-  uint8_t *getCellPairVoltageState(size_t oddCellNumber) override;
-  uint8_t *getNumberOfTemperatureSensorsForWarningInfo() override;
-  uint8_t *getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) override;
-  uint8_t *getModuleChargeVoltageState() override;
-  uint8_t *getModuleDischargeVoltageState() override;
-  uint8_t *getCellChargeVoltageState() override;
-  uint8_t *getCellDischargeVoltageState() override;
-  uint8_t *getModuleChargeCurrentState() override;
-  uint8_t *getModuleDischargeCurrentState() override;
-  uint8_t *getModuleChargeTemperatureState() override;
-  uint8_t *getModuleDischargeTemperatureState() override;
-  uint8_t *getCellChargeTemperatureState() override;
-  uint8_t *getCellDischargeTemperatureState() override;
+  uint16_t getNumberOfCellsForWarningInfo() override;
+  uint16_t getCellPairVoltageState(size_t oddCellNumber) override;
+  uint16_t getNumberOfTemperatureSensorsForWarningInfo() override;
+  uint16_t getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) override;
+  uint16_t getModuleChargeVoltageState() override;
+  uint16_t getModuleDischargeVoltageState() override;
+  uint16_t getCellChargeVoltageState() override;
+  uint16_t getCellDischargeVoltageState() override;
+  uint16_t getModuleChargeCurrentState() override;
+  uint16_t getModuleDischargeCurrentState() override;
+  uint16_t getModuleChargeTemperatureState() override;
+  uint16_t getModuleDischargeTemperatureState() override;
+  uint16_t getCellChargeTemperatureState() override;
+  uint16_t getCellDischargeTemperatureState() override;
 
   // BMS charge and discharge information inquiry
-  uint8_t *getChargeVoltageLimit() override;
-  uint8_t *getDischargeVoltageLimit() override;
-  uint8_t *getChargeCurrentLimit() override;
-  uint8_t *getDischargeCurrentLimit() override;
-  uint8_t *getChargeDischargeStatus() override;
-  uint8_t *getRuntimeToEmptySeconds() override;
+  uint16_t getChargeVoltageLimit() override;
+  uint16_t getDischargeVoltageLimit() override;
+  uint16_t getChargeCurrentLimit() override;
+  uint16_t getDischargeCurrentLimit() override;
+  uint16_t getChargeDischargeStatus() override;
+  uint16_t getRuntimeToEmptySeconds() override;
 
   // End BMSLibProtocolDataAdapter overrides
 
@@ -180,10 +188,39 @@ class JkBms: public jk_modbus::JkModbusDevice, public sdragos::mppsolar::BMSLibP
   bool discharging_binary_sensor_;
   bool discharging_switch_binary_sensor_;
   bool dedicated_charger_switch_binary_sensor_;
-  bool online_status_ = false;
-  bool has_recent_data_ = false;
+  // Written by the task that polls the BMS, read by the inverter task through hasUpdatedData()
+  std::atomic<bool> online_status_{false};
+  std::atomic<bool> has_recent_data_{false};
   uint32_t last_successful_read_data_ = 0;
 
+  uint32_t min_update_interval_{5000};
+  uint32_t max_update_interval_{5000};
+  // The values of the previous status frame the interval is adapted to
+  bool has_previous_status_{false};
+  float previous_current_{0.0f};
+  float previous_delta_cell_voltage_{0.0f};
+  uint16_t previous_errors_bitmask_{0};
+
+  // Registers read one by one by a fast update, in this order. The total voltage comes before the current,
+  // which the power is computed from.
+  static constexpr uint8_t FAST_UPDATE_REGISTERS[] = {0x83, 0x84, 0x85, 0x8B, 0x8C};
+  static constexpr uint8_t FAST_UPDATE_REGISTERS_SIZE = sizeof(FAST_UPDATE_REGISTERS);
+  // Registers a status frame needs before its data is passed on: those the Lib protocol replies are built from
+  // and the protocol version the current of the fast updates is decoded with
+  static constexpr uint8_t ESSENTIAL_STATUS_REGISTERS[] = {0x79, 0x81, 0x82, 0x83, 0x84, 0x85,
+                                                           0x86, 0x8B, 0x8C, 0xAA, 0xC0};
+
+  uint32_t full_update_interval_{0};
+  uint32_t last_full_update_{0};
+  bool has_full_update_{false};
+  bool fast_updates_supported_{true};
+  // Fast updates in a row that went unanswered. Fast updates stop at FAST_UPDATE_MAX_FAILURES, until the next
+  // full update probes them again.
+  static constexpr uint8_t FAST_UPDATE_MAX_FAILURES = 3;
+  uint8_t fast_update_failures_{0};
+  // The register a fast update is waiting for, FAST_UPDATE_REGISTERS_SIZE when none is in progress
+  uint8_t fast_register_index_{FAST_UPDATE_REGISTERS_SIZE};
+
   std::string errors_text_sensor_;
   std::string operation_mode_text_sensor_;
   std::string battery_type_text_sensor_;
@@ -193,22 +230,67 @@ class JkBms: public jk_modbus::JkModbusDevice, public sdragos::mppsolar::BMSLibP
   std::string manufacturer_text_sensor_;
   std::string total_runtime_formatted_text_sensor_;
 
+  static const uint8_t MAX_CELLS = 24;
+  static const uint8_t MAX_TEMPERATURE_SENSORS = 4;
+
+  // How the value of a status register is decoded
+  enum class RegisterType : uint8_t {
+    // Unsigned big endian value of 1, 2 or 4 bytes, times scale
+    UNSIGNED,
+    // Signed 16 bit value, times scale
+    SIGNED,
+    // 16 bit temperature, values above 100 are below 0 °C
+    TEMPERATURE,
+    // Decoded by its own case in decode_registers_()
+    SPECIAL,
+    // Only stepped over
+    SKIPPED,
+  };
+
+  struct StatusRegister {
+    uint8_t id;
+    // Bytes of the value, the cell voltages (0x79) start with their own length instead
+    uint8_t width;
+    RegisterType type;
+    float scale;
+    float JkBms::*target;
+  };
+
+  static const StatusRegister STATUS_REGISTERS[];
+  static const uint8_t STATUS_REGISTERS_SIZE;
+  static const uint8_t NO_STATUS_REGISTER = 0xFF;
+  // The 4 bytes that end the data of every frame
+  static const uint8_t RECORD_NUMBER_SIZE = 4;
+  // Position in STATUS_REGISTERS of every register ID, NO_STATUS_REGISTER for unknown ones
+  static const std::array<uint8_t, 256> STATUS_REGISTER_INDEX;
+  static constexpr std::array<uint8_t, 256> make_status_register_index_();
+
   uint8_t cell_count_;
 
   struct Cell {
     float cell_voltage_sensor_;
-  } cells_[24];
+  } cells_[MAX_CELLS];
 
   struct TemperatureSensor {
     float temperature_sensor_;
-  } temperature_sensors_[4];
-
-  bool enable_fake_traffic_;
-  uint8_t no_response_count_{0};
-
-  void on_status_data_(const std::vector<uint8_t> &data);
-  void reset_online_status_tracker_();
-  void track_online_status_();
+  } temperature_sensors_[MAX_TEMPERATURE_SENSORS];
+
+  bool enable_fake_traffic_{false};
+
+  void on_jk_modbus_online_changed(bool online) override;
+  void on_jk_modbus_unanswered(uint8_t function, uint8_t address) override;
+  void on_status_data_(const jk_modbus::JkFrameView &data);
+  void on_register_data_(const jk_modbus::JkFrameView &data);
+  // Decodes the registers in data in a single pass, in whatever order and number they come, up to the record
+  // number that ends the data. Stops at an ID of unknown width, returns false when registers were left
+  // undecoded. Sets the bit of the STATUS_REGISTERS position of every register decoded in decoded.
+  bool decode_registers_(const jk_modbus::JkFrameView &data, uint64_t &decoded);
+  void update_cell_voltages_(const uint8_t *cell_data, uint8_t cells);
+  void update_current_(uint16_t raw_current, uint8_t protocol_version);
+  void update_errors_(uint16_t raw_errors_bitmask);
+  void update_operation_mode_(uint16_t raw_modes_bitmask);
+  void track_recent_data_();
+  void adapt_update_interval_();
 
   std::string error_bits_to_string_(uint16_t bitmask);
   std::string mode_bits_to_string_(uint16_t bitmask);
@@ -11,36 +11,51 @@ static const char *const TAG = "jk_modbus";
 void JkModbus::loop() {
   const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000ULL);
   if (now - this->last_jk_modbus_byte_ > this->rx_timeout_) {
-    this->rx_buffer_.clear();
+    this->rx_len_ = 0;
     this->last_jk_modbus_byte_ = now;
   }
 
   size_t iterationCount = 0;
-  while (this->available()) {
-    uint8_t byte;
-    this->read_byte(&byte);
-    if (this->parse_jk_modbus_byte_(byte)) {
-      this->last_jk_modbus_byte_ = now;
-    } else {
-      if (!this->rx_buffer_.empty()){
-        do{
-          this->rx_buffer_.erase(this->rx_buffer_.begin());
-          if (!this->rx_buffer_.empty() && this->rx_buffer_.at(0) == 0x4E)
-          {
-            ESP_LOGW(TAG, "Found next possible start of frame.");
-            this->last_jk_modbus_byte_ = now;
-            break;
-          }
+  uint8_t chunk[RX_CHUNK_SIZE];
+  size_t chunk_len;
+  while ((chunk_len = this->read_available(chunk, RX_CHUNK_SIZE)) > 0) {
+    for (size_t i = 0; i < chunk_len; i++) {
+      // Noise between frames is skipped without buffering it
+      if (this->rx_len_ == 0 && chunk[i] != 0x4E)
+        continue;
+
+      this->push_rx_byte_(chunk[i]);
+
+      // A failed check can leave bytes that start another frame, they are checked right away
+      while (this->rx_len_ > 0) {
+        RxFrameStatus status = this->check_rx_frame_();
+        if (status == RxFrameStatus::INCOMPLETE) {
+          this->last_jk_modbus_byte_ = now;
+          break;
+        }
+
+        if (status == RxFrameStatus::COMPLETE) {
+          const uint16_t frame_len = this->rx_data_len_ + 2;
+          this->on_rx_frame_(&this->rx_ring_[this->rx_start_], this->rx_data_len_);
+          this->rx_start_ = (this->rx_start_ + frame_len) & (RX_RING_SIZE - 1);
+          this->rx_len_ -= frame_len;
+          continue;
         }
-        while(!this->rx_buffer_.empty());
+
+        this->resync_rx_buffer_();
       }
     }
 
-    if (iterationCount++ > 195 && this->rx_buffer_.size() == 0){
+    iterationCount += chunk_len;
+    if (iterationCount > 195 && this->rx_len_ == 0){
       //Breaking out of the loop to avoid starving other tasks
       break;
     }
   }
+
+  // After the received bytes, so a reply that is already in doesn't count as a timeout
+  this->check_transaction_timeout_(now);
+  this->update_devices_(now);
 }
 
 uint16_t chksum(const uint8_t data[], const uint16_t len) {
@@ -51,75 +66,319 @@ uint16_t chksum(const uint8_t data[], const uint16_t len) {
   return checksum;
 }
 
-bool JkModbus::parse_jk_modbus_byte_(uint8_t byte) {
-  size_t at = this->rx_buffer_.size();
-  this->rx_buffer_.push_back(byte);
-  const uint8_t *raw = &this->rx_buffer_[0];
+void JkModbus::push_rx_byte_(uint8_t byte) {
+  // The length check keeps frames shorter than the ring, so a byte never overwrites the current frame
+  const uint16_t position = (this->rx_start_ + this->rx_len_) & (RX_RING_SIZE - 1);
+  this->rx_ring_[position] = byte;
+  this->rx_ring_[position + RX_RING_SIZE] = byte;
+  this->rx_sums_[position] = this->rx_sum_;
+  this->rx_sum_ += byte;
+  this->rx_len_++;
+}
 
-  // Byte 0: Start sequence (0x4E)
-  if (at == 0){
-    if (raw[0] == 0x4E)
-      return true;
-    else
-      return false;
-  }
+JkModbus::RxFrameStatus JkModbus::check_rx_frame_() {
+  const uint8_t *raw = &this->rx_ring_[this->rx_start_];
 
-  uint8_t address = raw[0];
+  // Byte 0: Start sequence (0x4E)
+  if (raw[0] != 0x4E)
+    return RxFrameStatus::INVALID;
 
   // Byte 1: Start sequence (0x57)
-  if (at == 1){
-    if (raw[1] == 0x57)
-      return true;
-    else
-    {
-      //ESP_LOGW(TAG, "Invalid header");
-      return false;
-    }
-  }
+  if (this->rx_len_ < 2)
+    return RxFrameStatus::INCOMPLETE;
+  if (raw[1] != 0x57)
+    return RxFrameStatus::INVALID;
 
   // Byte 2: Size (low byte)
-  if (at == 2)
-    return true;
-
   // Byte 3: Size (high byte)
-  if (at == 3)
-    return true;
-  uint16_t data_len = (uint16_t(raw[2]) << 8 | (uint16_t(raw[2 + 1]) << 0));
+  if (this->rx_len_ < 4)
+    return RxFrameStatus::INCOMPLETE;
+  const uint16_t data_len = (uint16_t(raw[2]) << 8 | (uint16_t(raw[2 + 1]) << 0));
+  if (data_len < MIN_FRAME_DATA_LEN || data_len > MAX_FRAME_DATA_LEN) {
+    ESP_LOGV(TAG, "Invalid frame length %u", data_len);
+    return RxFrameStatus::INVALID;
+  }
+
+  // data_len-3: End sequence (0x68), followed by 2 unused bytes
+  if (this->rx_len_ <= data_len - 3)
+    return RxFrameStatus::INCOMPLETE;
+  if (raw[data_len - 3] != 0x68) {
+    ESP_LOGV(TAG, "Invalid end of frame 0x%02X", raw[data_len - 3]);
+    return RxFrameStatus::INVALID;
+  }
 
   // data_len: CRC_LO (over all bytes)
-  if (at <= data_len)
-    return true;
+  // data_len+1: CRC_HI (over all bytes)
+  if (this->rx_len_ < data_len + 2)
+    return RxFrameStatus::INCOMPLETE;
+  const uint16_t checksum = this->rx_sums_[(this->rx_start_ + data_len) & (RX_RING_SIZE - 1)] -
+                            this->rx_sums_[this->rx_start_];
+  const uint16_t remote_crc = uint16_t(raw[data_len]) << 8 | (uint16_t(raw[data_len + 1]) << 0);
+  if (checksum != remote_crc) {
+    ESP_LOGV(TAG, "CRC check failed! 0x%04X != 0x%04X", checksum, remote_crc);
+    return RxFrameStatus::INVALID;
+  }
 
+  this->rx_data_len_ = data_len;
+  return RxFrameStatus::COMPLETE;
+}
+
+void JkModbus::on_rx_frame_(const uint8_t *raw, uint16_t data_len) {
+  uint8_t address = raw[0];
   uint8_t function = raw[8];
+  const uint32_t terminal_number = (uint32_t(raw[4]) << 24) | (uint32_t(raw[5]) << 16) | (uint32_t(raw[6]) << 8) |
+                                   (uint32_t(raw[7]) << 0);
+  const bool upload = raw[10] == FRAME_TYPE_ACTIVE_UPLOAD;
 
-  // data_len+1: CRC_HI (over all bytes)
-  uint16_t computed_crc = chksum(raw, data_len);
-  uint16_t remote_crc = uint16_t(raw[data_len]) << 8 | (uint16_t(raw[data_len + 1]) << 0);
-  if (computed_crc != remote_crc) {
-    ESP_LOGW(TAG, "CRC check failed! 0x%04X != 0x%04X", computed_crc, remote_crc);
-    return false;
+  // Requests, our own echoed back by the adapter included, are neither replies nor data
+  if (raw[10] != FRAME_TYPE_REPLY && !upload) {
+    ESP_LOGD(TAG, "Ignoring frame of type 0x%02X", raw[10]);
+    return;
   }
 
-  std::vector<uint8_t> data(this->rx_buffer_.begin() + 11, this->rx_buffer_.begin() + data_len - 3);
+  // The data is handed over in place, the frame is contiguous in the ring buffer
+  JkFrameView data(raw + 11, data_len - 3 - 11);
+
+  // Every pack on the bus replies from the same address, so a reply goes to the device that sent the request
+  JkModbusDevice *requester = nullptr;
+  if (!upload && this->transaction_.device != nullptr && this->transaction_.device->address_ == address &&
+      this->transaction_.function == function && is_for_device_(this->transaction_.device, terminal_number)) {
+    requester = this->transaction_.device;
+    this->finish_transaction_(true);
+  }
+
+  if (upload)
+    this->stats_.uploads++;
 
   bool found = false;
   for (auto *device : this->devices_) {
-    if (device->address_ == address) {
+    if (device->address_ == address && (requester == nullptr || device == requester) &&
+        is_for_device_(device, terminal_number)) {
+      // An upload takes the place of a reply, the device is not polled while they keep coming. It only goes to
+      // the pack with the terminal number it carries, the other packs on the bus are still polled.
+      if (upload) {
+        if (!device->uploading_ && this->upload_timeout_ != 0)
+          ESP_LOGI(TAG, "Device 0x%02X uploads its data, not polling it", device->address_);
+        device->uploading_ = this->upload_timeout_ != 0;
+        device->last_upload_ = (uint32_t)(esp_timer_get_time() / 1000ULL);
+        this->set_device_online_(device, true);
+      }
       device->on_jk_modbus_data(function, data);
       found = true;
     }
   }
   if (!found) {
-    ESP_LOGW(TAG, "Got JkModbus frame from unknown address 0x%02X!", address);
+    ESP_LOGW(TAG, "Got JkModbus frame from unknown address 0x%02X, terminal number 0x%08lX!", address,
+             (unsigned long) terminal_number);
+  }
+}
+
+bool JkModbus::is_for_device_(const JkModbusDevice *device, uint32_t terminal_number) {
+  return device->terminal_number_ == 0 || device->terminal_number_ == terminal_number;
+}
+
+bool JkModbus::register_device(JkModbusDevice *device) {
+  // All packs reply from the same address, only different terminal numbers keep their requests apart
+  for (auto *registered : this->devices_) {
+    if (registered->address_ == device->address_ &&
+        (registered->terminal_number_ == 0 || device->terminal_number_ == 0 ||
+         registered->terminal_number_ == device->terminal_number_)) {
+      ESP_LOGE(TAG, "Device 0x%02X terminal number 0x%08lX collides with terminal number 0x%08lX, not registered",
+               device->address_, (unsigned long) device->terminal_number_,
+               (unsigned long) registered->terminal_number_);
+      return false;
+    }
+  }
+  this->devices_.push_back(device);
+  return true;
+}
+
+void JkModbus::resync_rx_buffer_() {
+  do {
+    this->rx_start_ = (this->rx_start_ + 1) & (RX_RING_SIZE - 1);
+    this->rx_len_--;
+  } while (this->rx_len_ > 0 && this->rx_ring_[this->rx_start_] != 0x4E);
+  this->rx_false_starts_++;
+}
+
+void JkModbus::update_devices_(uint32_t now) {
+  // The bus is half-duplex, a device only gets its turn once the previous reply is in or given up on
+  if (this->is_busy())
+    return;
+
+  JkModbusDevice *next = nullptr;
+  int32_t next_overdue = 0;
+  for (auto *device : this->devices_) {
+    const int32_t overdue = (int32_t)(now - device->next_update_);
+    if ((device->next_update_ != 0 && overdue < 0) || this->is_uploading_(device, now))
+      continue;
+
+    // The highest priority first, then the one that waited longest, which goes round the devices in turn
+    if (next == nullptr || device->priority_ > next->priority_ ||
+        (device->priority_ == next->priority_ && overdue > next_overdue)) {
+      next = device;
+      next_overdue = overdue;
+    }
+  }
+  if (next == nullptr)
+    return;
+
+  // Keeps the interval from drifting by the time the device waited for the bus, without catching up on missed
+  // updates after a long wait
+  if (next->next_update_ == 0 || next_overdue >= (int32_t) next->update_interval_) {
+    next->next_update_ = now + next->update_interval_;
+  } else {
+    next->next_update_ += next->update_interval_;
+  }
+  if (next->next_update_ == 0)
+    next->next_update_ = 1;
+
+  next->update();
+}
+
+void JkModbusDevice::set_update_interval(uint32_t update_interval) {
+  this->update_interval_ = update_interval;
+  if (this->next_update_ == 0)
+    return;
+
+  const uint32_t now = (uint32_t)(esp_timer_get_time() / 1000ULL);
+  if ((int32_t)(this->next_update_ - (now + update_interval)) > 0)
+    this->next_update_ = now + update_interval;
+}
+
+bool JkModbus::is_uploading_(JkModbusDevice *device, uint32_t now) {
+  if (!device->uploading_)
+    return false;
+
+  // Falls back to polling once the uploads stop, the device is due right away
+  if (now - device->last_upload_ > this->upload_timeout_) {
+    ESP_LOGW(TAG, "No upload from device 0x%02X for %lu ms, polling it again", device->address_,
+             (unsigned long) (now - device->last_upload_));
+    device->uploading_ = false;
+    device->next_update_ = 0;
+    return false;
   }
 
-  // return false to reset buffer
-  return false;
+  return true;
+}
+
+bool JkModbus::request(JkModbusDevice *device, uint8_t function, uint8_t address) {
+  if (this->is_busy()) {
+    ESP_LOGW(TAG, "Request 0x%02X not sent, still waiting for the reply to 0x%02X", function,
+             this->transaction_.function);
+    return false;
+  }
+
+  this->transaction_.device = device;
+  this->transaction_.function = function;
+  this->transaction_.address = address;
+  this->transaction_.attempts = 1;
+  this->transaction_.sent_at_us = esp_timer_get_time();
+  this->transaction_.started_at_us = this->transaction_.sent_at_us;
+  if (this->stats_.busy_since_us == 0)
+    this->stats_.busy_since_us = this->transaction_.started_at_us;
+  this->transaction_.deadline = (uint32_t)(this->transaction_.sent_at_us / 1000ULL) + this->response_timeout_;
+  this->stats_.requests++;
+
+  this->read_registers(function, address, device->terminal_number_);
+  return true;
+}
+
+void JkModbus::check_transaction_timeout_(uint32_t now) {
+  Transaction &transaction = this->transaction_;
+  if (transaction.device == nullptr || (int32_t)(now - transaction.deadline) < 0)
+    return;
+
+  // A reply that is still coming in gets the time it needs, the RX timeout drops it if it stalls
+  if (transaction.sent_at_us != 0 && this->rx_len_ > 0)
+    return;
+
+  // The backoff after a timeout is over, send the next attempt
+  if (transaction.sent_at_us == 0) {
+    transaction.attempts++;
+    transaction.sent_at_us = esp_timer_get_time();
+    transaction.deadline = now + this->response_timeout_;
+    this->stats_.retries++;
+    this->read_registers(transaction.function, transaction.address, transaction.device->terminal_number_);
+    return;
+  }
+
+  if (transaction.attempts >= this->max_attempts_) {
+    ESP_LOGW(TAG, "No reply to 0x%02X after %u attempts", transaction.function, transaction.attempts);
+    this->finish_transaction_(false);
+    return;
+  }
+
+  ESP_LOGD(TAG, "No reply to 0x%02X, attempt %u", transaction.function, transaction.attempts);
+  transaction.sent_at_us = 0;
+  transaction.deadline = now + (RETRY_BACKOFF_MS << (transaction.attempts - 1));
+}
+
+void JkModbus::finish_transaction_(bool answered) {
+  JkModbusDevice *device = this->transaction_.device;
+  const int64_t sent_at_us = this->transaction_.sent_at_us;
+  const uint8_t function = this->transaction_.function;
+  const uint8_t address = this->transaction_.address;
+  const int64_t now_us = esp_timer_get_time();
+  this->stats_.busy_us += now_us - this->transaction_.started_at_us;
+  this->transaction_ = Transaction{};
+
+  if (!answered) {
+    this->stats_.failures++;
+    this->set_device_online_(device, false);
+    device->on_jk_modbus_unanswered(function, address);
+    return;
+  }
+
+  const uint32_t response_time_us = (uint32_t)(now_us - sent_at_us);
+  device->response_time_us_ = response_time_us;
+  this->stats_.replies++;
+  this->stats_.total_response_time_us += response_time_us;
+  if (response_time_us < this->stats_.min_response_time_us)
+    this->stats_.min_response_time_us = response_time_us;
+  if (response_time_us > this->stats_.max_response_time_us)
+    this->stats_.max_response_time_us = response_time_us;
+
+  this->set_device_online_(device, true);
+}
+
+void JkModbus::set_device_online_(JkModbusDevice *device, bool online) {
+  if (device->online_ == online)
+    return;
+
+  ESP_LOGI(TAG, "Device 0x%02X is %s", device->address_, online ? "online" : "offline");
+  device->online_ = online;
+  device->on_jk_modbus_online_changed(online);
 }
 
 void JkModbus::dump_config() {
   ESP_LOGI(TAG, "JkModbus:");
   ESP_LOGI(TAG, "  RX timeout: %d ms", this->rx_timeout_);
+  ESP_LOGI(TAG, "  Response timeout: %u ms, %u attempts", this->response_timeout_, this->max_attempts_);
+  ESP_LOGI(TAG, "  Requests: %lu sent, %lu replied, %lu retries, %lu failed", (unsigned long) this->stats_.requests,
+           (unsigned long) this->stats_.replies, (unsigned long) this->stats_.retries,
+           (unsigned long) this->stats_.failures);
+  ESP_LOGI(TAG, "  Active uploads: %lu received, upload timeout %lu ms", (unsigned long) this->stats_.uploads,
+           (unsigned long) this->upload_timeout_);
+  ESP_LOGI(TAG, "  False starts: %lu dropped", (unsigned long) this->rx_false_starts_);
+  if (this->stats_.replies != 0)
+    ESP_LOGI(TAG, "  Response time: min %lu us, avg %lu us, max %lu us",
+             (unsigned long) this->stats_.min_response_time_us,
+             (unsigned long) (this->stats_.total_response_time_us / this->stats_.replies),
+             (unsigned long) this->stats_.max_response_time_us);
+
+  const int64_t now_us = esp_timer_get_time();
+  if (this->stats_.busy_since_us != 0 && now_us > this->stats_.busy_since_us)
+    ESP_LOGI(TAG, "  Bus utilization: %.1f%%",
+             100.0f * (float) this->stats_.busy_us / (float) (now_us - this->stats_.busy_since_us));
+  this->stats_.busy_us = 0;
+  this->stats_.busy_since_us = now_us;
+
+  for (auto *device : this->devices_) {
+    ESP_LOGI(TAG, "  Device 0x%02X terminal 0x%08lX: every %lu ms, priority %u, %s%s", device->address_,
+             (unsigned long) device->terminal_number_, (unsigned long) device->update_interval_, device->priority_,
+             device->online_ ? "online" : "offline", device->uploading_ ? ", uploading" : "");
+  }
 }
 float JkModbus::get_setup_priority() const {
   // After UART bus
@@ -127,16 +386,16 @@ float JkModbus::get_setup_priority() const {
 }
 
 // The manufacturer states that no write operations are possible via the serial interface.
-void JkModbus::send(uint8_t function, uint8_t address, uint8_t value) {
+void JkModbus::send(uint8_t function, uint8_t address, uint8_t value, uint32_t terminal_number) {
   uint8_t frame[22];
   frame[0] = 0x4E;      // start sequence
   frame[1] = 0x57;      // start sequence
   frame[2] = 0x00;      // data length lb
   frame[3] = 0x14;      // data length hb
-  frame[4] = 0x00;      // bms terminal number
-  frame[5] = 0x00;      // bms terminal number
-  frame[6] = 0x00;      // bms terminal number
-  frame[7] = 0x00;      // bms terminal number
+  frame[4] = terminal_number >> 24;  // bms terminal number
+  frame[5] = terminal_number >> 16;  // bms terminal number
+  frame[6] = terminal_number >> 8;   // bms terminal number
+  frame[7] = terminal_number >> 0;   // bms terminal number
   frame[8] = function;  // command word: 0x01 (activation), 0x02 (write), 0x03 (read), 0x05 (password), 0x06 (read all)
   frame[9] = 0x02;      // frame source: 0x00 (bms), 0x01 (bluetooth), 0x02 (gps), 0x03 (computer)
   frame[10] = 0x02;     // frame type: 0x00 (read data), 0x01 (reply frame), 0x02 (BMS active upload)
@@ -153,20 +412,20 @@ void JkModbus::send(uint8_t function, uint8_t address, uint8_t value) {
   frame[20] = crc >> 8;
   frame[21] = crc >> 0;
 
+  // Not waiting for the frame to go out, the UART sends it while the caller carries on
   this->write_array(frame, 22);
-  this->flush();
 }
 
-void JkModbus::read_registers(uint8_t function, uint8_t address) {
+void JkModbus::read_registers(uint8_t function, uint8_t address, uint32_t terminal_number) {
   uint8_t frame[21];
   frame[0] = 0x4E;      // start sequence
   frame[1] = 0x57;      // start sequence
   frame[2] = 0x00;      // data length lb
   frame[3] = 0x13;      // data length hb
-  frame[4] = 0x00;      // bms terminal number
-  frame[5] = 0x00;      // bms terminal number
-  frame[6] = 0x00;      // bms terminal number
-  frame[7] = 0x00;      // bms terminal number
+  frame[4] = terminal_number >> 24;  // bms terminal number
+  frame[5] = terminal_number >> 16;  // bms terminal number
+  frame[6] = terminal_number >> 8;   // bms terminal number
+  frame[7] = terminal_number >> 0;   // bms terminal number
   frame[8] = function;  // command word: 0x01 (activation), 0x02 (write), 0x03 (read), 0x05 (password), 0x06 (read all)
   frame[9] = 0x03;      // frame source: 0x00 (bms), 0x01 (bluetooth), 0x02 (gps), 0x03 (computer)
   frame[10] = 0x00;     // frame type: 0x00 (read data), 0x01 (reply frame), 0x02 (BMS active upload)
@@ -183,7 +442,6 @@ void JkModbus::read_registers(uint8_t function, uint8_t address) {
   frame[20] = crc >> 0;
 
   this->write_array(frame, 21);
-  this->flush();
 }
 
 }  // namespace jk_modbus
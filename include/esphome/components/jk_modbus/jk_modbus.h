@@ -9,6 +9,23 @@ namespace jk_modbus {
 
 class JkModbusDevice;
 
+// Non-owning view of the data of a received frame. It points into the receive buffer of JkModbus, so it is
+// only valid during the on_jk_modbus_data() call. Reads past the end return 0 instead of touching other memory.
+class JkFrameView {
+ public:
+  JkFrameView(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  size_t size() const { return this->size_; }
+  bool empty() const { return this->size_ == 0; }
+  uint8_t operator[](size_t i) const { return i < this->size_ ? this->data_[i] : 0; }
+  const uint8_t *begin() const { return this->data_; }
+  const uint8_t *end() const { return this->data_ + this->size_; }
+
+ protected:
+  const uint8_t *data_;
+  size_t size_;
+};
+
 class JkModbus : public uart::UARTDevice, public Component {
  public:
   JkModbus() = default;
@@ -19,37 +36,176 @@ class JkModbus : public uart::UARTDevice, public Component {
 
   void dump_config() override;
 
-  void register_device(JkModbusDevice *device) { this->devices_.push_back(device); }
+  // Packs on one bus are told apart by their terminal number, which has to be set before. A device is not
+  // registered, and false returned, when its frames can't be told apart from those of a registered one.
+  bool register_device(JkModbusDevice *device);
 
   float get_setup_priority() const override;
 
-  void send(uint8_t function, uint8_t address, uint8_t value);
-  void read_registers(uint8_t function, uint8_t address);
+  void send(uint8_t function, uint8_t address, uint8_t value, uint32_t terminal_number = 0);
+  void read_registers(uint8_t function, uint8_t address, uint32_t terminal_number = 0);
   void set_rx_timeout(uint16_t rx_timeout) { rx_timeout_ = rx_timeout; }
 
- protected:
-  bool parse_jk_modbus_byte_(uint8_t byte);
+  // Sends a read request for device without waiting for it to go out. The reply is matched by device address
+  // and function in loop(), unanswered requests are sent again up to the configured number of attempts.
+  // Only one request is outstanding at a time, returns false when another one is still in flight.
+  bool request(JkModbusDevice *device, uint8_t function, uint8_t address);
+  bool is_busy() const { return this->transaction_.device != nullptr; }
+
+  // Time a reply has to be completely received in, from sending the request
+  void set_response_timeout(uint16_t response_timeout) { response_timeout_ = response_timeout; }
+  // Requests sent before the device is considered offline, the first attempt included
+  void set_max_attempts(uint8_t max_attempts) { max_attempts_ = max_attempts; }
+  // A device that uploads its data by itself is not polled while its uploads are at most this far apart.
+  // 0 keeps polling every device, uploads are still passed on.
+  void set_upload_timeout(uint32_t upload_timeout) { upload_timeout_ = upload_timeout; }
 
-  std::vector<uint8_t> rx_buffer_;
+ protected:
+  enum class RxFrameStatus {
+    INCOMPLETE,
+    INVALID,
+    COMPLETE,
+  };
+
+  void push_rx_byte_(uint8_t byte);
+  // Checks the frame at the current start of frame. Only the header, the end of frame and the checksum bytes
+  // are looked at, the checksum comes from the running sums, so every check takes constant time whatever the
+  // length field claims.
+  RxFrameStatus check_rx_frame_();
+  void on_rx_frame_(const uint8_t *raw, uint16_t data_len);
+  // True when a frame with this terminal number is meant for the device
+  static bool is_for_device_(const JkModbusDevice *device, uint32_t terminal_number);
+  // Lets the most urgent device that is due send its request, while the bus is free
+  void update_devices_(uint32_t now);
+  // Returns true while the device uploads often enough to not be polled
+  bool is_uploading_(JkModbusDevice *device, uint32_t now);
+  // Sends the request of the current transaction again or gives up on it, once its deadline has passed
+  void check_transaction_timeout_(uint32_t now);
+  void finish_transaction_(bool answered);
+  void set_device_online_(JkModbusDevice *device, bool online);
+  // Drops the first buffered byte and skips forward to the next 0x4E, without moving any bytes
+  void resync_rx_buffer_();
+
+  // Bytes taken from the UART driver at once
+  static const size_t RX_CHUNK_SIZE = 64;
+  // Bounds of the length field of a frame. The shortest frame is a read request, a status frame of a 24 cell
+  // pack is about 300 bytes. Anything outside is a corrupt length, which would otherwise make the parser wait
+  // for (and buffer) up to 64KB.
+  static const uint16_t MIN_FRAME_DATA_LEN = 19;
+  static const uint16_t MAX_FRAME_DATA_LEN = 600;
+
+  // The bytes of the frame being received are kept in a ring buffer larger than any frame, indexed with a
+  // mask. Every byte is also written one ring length further, so a frame is always contiguous in memory even
+  // when it wraps around the end of the ring.
+  static const uint16_t RX_RING_SIZE = 1024;
+  static_assert(MAX_FRAME_DATA_LEN + 2 <= RX_RING_SIZE, "A frame must fit in the ring buffer.");
+
+  uint8_t rx_ring_[2 * RX_RING_SIZE]{};
+  uint16_t rx_start_{0};
+  uint16_t rx_len_{0};
+
+  // Additive checksum of every byte received before the one at the same position of the ring, the checksum of
+  // a frame is the difference of two of them
+  uint16_t rx_sums_[RX_RING_SIZE]{};
+  uint16_t rx_sum_{0};
+  // Length field of the last complete frame
+  uint16_t rx_data_len_{0};
+  // Start bytes dropped because no valid frame started at them, counted instead of logged: a stream of false
+  // starts would log at every byte
+  uint32_t rx_false_starts_{0};
   uint16_t rx_timeout_{50};
   uint32_t last_jk_modbus_byte_{0};
   std::vector<JkModbusDevice *> devices_;
+
+  // Waits after a timeout before the next attempt, doubled with every attempt
+  static const uint16_t RETRY_BACKOFF_MS = 100;
+  // Frame types of the replies to a request and of the frames a BMS sends by itself
+  static const uint8_t FRAME_TYPE_REPLY = 0x01;
+  static const uint8_t FRAME_TYPE_ACTIVE_UPLOAD = 0x02;
+
+  struct Transaction {
+    // nullptr when no request is in flight
+    JkModbusDevice *device{nullptr};
+    uint8_t function{0};
+    uint8_t address{0};
+    uint8_t attempts{0};
+    int64_t sent_at_us{0};
+    // When the first attempt was sent, for the bus utilization
+    int64_t started_at_us{0};
+    // Until the reply of the last attempt is due, or until the next attempt when sent_at_us is 0
+    uint32_t deadline{0};
+  } transaction_;
+
+  uint16_t response_timeout_{500};
+  uint8_t max_attempts_{3};
+  uint32_t upload_timeout_{10000};
+
+  struct TransactionStats {
+    uint32_t requests{0};
+    uint32_t replies{0};
+    uint32_t retries{0};
+    uint32_t failures{0};
+    uint32_t uploads{0};
+    uint32_t min_response_time_us{UINT32_MAX};
+    uint32_t max_response_time_us{0};
+    uint64_t total_response_time_us{0};
+    // Time the bus was taken by transactions since busy_since_us, reset by dump_config()
+    uint64_t busy_us{0};
+    int64_t busy_since_us{0};
+  } stats_;
 };
 
 class JkModbusDevice {
  public:
   void set_parent(JkModbus *parent) { parent_ = parent; }
   void set_address(uint8_t address) { address_ = address; }
-  virtual void on_jk_modbus_data(const uint8_t &function, const std::vector<uint8_t> &data) = 0;
-
-  void send(int8_t function, uint8_t address, uint8_t value) { this->parent_->send(function, address, value); }
-  void read_registers(uint8_t function, uint8_t address) { this->parent_->read_registers(function, address); }
+  // Sent in the terminal number bytes of every request, a reply is only taken from the pack with the same
+  // one. 0, the default, is for the only pack on a bus, it takes frames with any terminal number.
+  void set_terminal_number(uint32_t terminal_number) { terminal_number_ = terminal_number; }
+  uint32_t get_terminal_number() const { return this->terminal_number_; }
+  virtual void on_jk_modbus_data(const uint8_t &function, const JkFrameView &data) = 0;
+
+  // Called by JkModbus when the device is due and the bus is free, sends the request(s) of an update
+  virtual void update() = 0;
+
+  // A shorter interval also brings the next update forward
+  void set_update_interval(uint32_t update_interval);
+  uint32_t get_update_interval() const { return this->update_interval_; }
+  // Among the devices that are due at the same time, the one with the highest priority is updated first
+  void set_priority(uint8_t priority) { priority_ = priority; }
+
+  void send(int8_t function, uint8_t address, uint8_t value) {
+    this->parent_->send(function, address, value, this->terminal_number_);
+  }
+  bool read_registers(uint8_t function, uint8_t address) { return this->parent_->request(this, function, address); }
+
+  // Online from the first reply until a request goes unanswered after all attempts
+  bool is_online() const { return this->online_; }
+  // Time from sending the last answered request to receiving the whole reply
+  uint32_t get_response_time_us() const { return this->response_time_us_; }
 
  protected:
   friend JkModbus;
 
+  // Called by JkModbus right before the data of a reply that brought the device back online, or after a request
+  // went unanswered
+  virtual void on_jk_modbus_online_changed(bool online) {}
+  // Called by JkModbus for every request that went unanswered after all attempts, offline or not
+  virtual void on_jk_modbus_unanswered(uint8_t function, uint8_t address) {}
+
   JkModbus *parent_;
   uint8_t address_;
+  uint32_t terminal_number_{0};
+  bool online_{false};
+  uint32_t response_time_us_{0};
+
+  uint32_t update_interval_{5000};
+  uint8_t priority_{0};
+  // When the next update is due, 0 updates right away
+  uint32_t next_update_{0};
+  // Set by the first active upload, cleared when they stop coming
+  bool uploading_{false};
+  uint32_t last_upload_{0};
 };
 
 }  // namespace jk_modbus
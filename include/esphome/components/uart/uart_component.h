@@ -35,11 +35,15 @@ namespace esphome
       bool read_byte(uint8_t *data) { return this->read_array(data, 1); };
       virtual bool peek_byte(uint8_t *data) = 0;
       virtual bool read_array(uint8_t *data, size_t len) = 0;
+      /// Read up to max_len bytes that were already received, without waiting. Returns the number of bytes read.
+      virtual size_t read_available(uint8_t *data, size_t max_len) = 0;
 
       /// Return available number of bytes.
       virtual int available() = 0;
       /// Block until all bytes have been written to the UART bus.
       virtual void flush() = 0;
+      /// Return true once all written bytes are out on the UART bus, without blocking.
+      virtual bool is_tx_done() = 0;
 
       bool is_failed() const { return this->failed_; }
       void mark_failed() { this->failed_ = true; }
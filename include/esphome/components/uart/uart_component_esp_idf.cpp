@@ -4,6 +4,8 @@
 
 #include "uart_component_esp_idf.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include <algorithm>
 
 namespace esphome
 {
@@ -66,6 +68,13 @@ namespace esphome
 
       ESP_LOGI(TAG, "Setting up UART %u...", this->uart_num_);
 
+      // The driver only takes a TX buffer larger than the hardware FIFO
+      if (this->tx_buffer_size_ != 0 && this->tx_buffer_size_ <= SOC_UART_FIFO_LEN)
+      {
+        ESP_LOGW(TAG, "TX buffer size %u is not above the FIFO size, writing without a TX buffer.", this->tx_buffer_size_);
+        this->tx_buffer_size_ = 0;
+      }
+
       this->lock_ = xSemaphoreCreateMutex();
 
       xSemaphoreTake(this->lock_, portMAX_DELAY);
@@ -131,6 +140,7 @@ namespace esphome
       {
         ESP_LOGD(TAG, "  RX Buffer Size: %u", this->rx_buffer_size_);
       }
+      ESP_LOGD(TAG, "  TX Buffer Size: %u", this->tx_buffer_size_);
       ESP_LOGD(TAG, "  Baud Rate: %lu baud", this->baud_rate_);
       ESP_LOGD(TAG, "  Data Bits: %u", this->data_bits_);
       ESP_LOGD(TAG, "  Parity: %d", this->parity_);
@@ -139,9 +149,9 @@ namespace esphome
 
     void IDFUARTComponent::write_array(const uint8_t *data, size_t len)
     {
-      xSemaphoreTake(this->lock_, portMAX_DELAY);
+      // The driver serializes writers itself, the lock only guards the peeked byte of the readers. So a
+      // write waiting for space in the TX buffer or FIFO doesn't hold up reading.
       uart_write_bytes(this->uart_num_, data, len);
-      xSemaphoreGive(this->lock_);
     }
 
     bool IDFUARTComponent::peek_byte(uint8_t *data)
@@ -190,6 +200,36 @@ namespace esphome
       return true;
     }
 
+    size_t IDFUARTComponent::read_available(uint8_t *data, size_t max_len)
+    {
+      size_t length_read = 0;
+      if (max_len == 0)
+        return 0;
+
+      // A single lock and driver call for everything that is buffered, instead of one per byte
+      xSemaphoreTake(this->lock_, portMAX_DELAY);
+      if (this->has_peek_)
+      {
+        *data = this->peek_byte_;
+        data++;
+        length_read++;
+        this->has_peek_ = false;
+      }
+
+      size_t buffered = 0;
+      uart_get_buffered_data_len(this->uart_num_, &buffered);
+      size_t length_to_read = std::min(buffered, max_len - length_read);
+      if (length_to_read > 0)
+      {
+        int len = uart_read_bytes(this->uart_num_, data, length_to_read, 0);
+        if (len > 0)
+          length_read += len;
+      }
+      xSemaphoreGive(this->lock_);
+
+      return length_read;
+    }
+
     int IDFUARTComponent::available()
     {
       size_t available;
@@ -205,10 +245,30 @@ namespace esphome
 
     void IDFUARTComponent::flush()
     {
-      ESP_LOGW(TAG, "    Flushing...");
-      xSemaphoreTake(this->lock_, portMAX_DELAY);
       uart_wait_tx_done(this->uart_num_, portMAX_DELAY);
+    }
+
+    bool IDFUARTComponent::is_tx_done()
+    {
+      return uart_wait_tx_done(this->uart_num_, 0) == ESP_OK;
+    }
+
+    void IDFUARTComponent::flush_input()
+    {
+      xSemaphoreTake(this->lock_, portMAX_DELAY);
+      uart_flush_input(this->uart_num_);
+      xQueueReset(this->uart_event_queue_);
+      this->has_peek_ = false;
       xSemaphoreGive(this->lock_);
     }
+
+    void IDFUARTComponent::set_rx_timeout(uint8_t characters)
+    {
+      xSemaphoreTake(this->lock_, portMAX_DELAY);
+      esp_err_t err = uart_set_rx_timeout(this->uart_num_, characters);
+      xSemaphoreGive(this->lock_);
+      if (err != ESP_OK)
+        ESP_LOGW(TAG, "uart_set_rx_timeout failed: %s", esp_err_to_name(err));
+    }
   } // namespace uart
 } // namespace esphome
\ No newline at end of file
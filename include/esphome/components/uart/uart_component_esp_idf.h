@@ -20,13 +20,23 @@ namespace esphome
       void dump_config() override;
       float get_setup_priority() const override { return esphome::setup_priority::BUS; }
 
+      // With a TX buffer, returns once the bytes are copied into it and the driver sends them in the
+      // background. Without one, returns once the last bytes are in the hardware FIFO.
       void write_array(const uint8_t *data, size_t len) override;
 
       bool peek_byte(uint8_t *data) override;
       bool read_array(uint8_t *data, size_t len) override;
+      size_t read_available(uint8_t *data, size_t max_len) override;
 
       int available() override;
       void flush() override;
+      bool is_tx_done() override;
+
+      // Drops the received bytes that were not read yet and the pending driver events, used after the
+      // receive FIFO or ring buffer overflowed.
+      void flush_input();
+      // Number of character times the line has to be idle before the driver reports the received bytes.
+      void set_rx_timeout(uint8_t characters);
 
       uint8_t get_hw_serial_number() { return this->uart_num_; }
       QueueHandle_t *get_uart_event_queue() { return &this->uart_event_queue_; }
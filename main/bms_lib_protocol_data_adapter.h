@@ -2,31 +2,34 @@
 
 #include <stddef.h>
 #include <cstdint>
+#include "esphome/core/component.h"
 
 namespace sdragos
 {
 
     namespace mppsolar
     {
+        // Getters return the payload value of the reply, which the UART handler sends MSB first. Nothing is
+        // allocated and there is no memory ownership to transfer.
         class BMSLibProtocolDataAdapter
         {
         public:                                                                                 // Payload size         Units
             // Returns true when data is available to be read
             virtual bool hasUpdatedData() = 0;
             // Version information
-            virtual uint8_t *getBMSFirmwareVersion() = 0;                                       //      4 bytes
-            virtual uint8_t *getBMSHardwareVersion() = 0;                                       //      4 bytes
+            virtual uint32_t getBMSFirmwareVersion() = 0;                                       //      4 bytes
+            virtual uint32_t getBMSHardwareVersion() = 0;                                       //      4 bytes
 
             // BMS general status
-            virtual uint8_t *getNumberOfCells() = 0;                                            //      2 bytes         1 count
-            virtual uint8_t *getCellVoltageOrNull(size_t cellNumber) = 0;                       //      2 bytes         0.1V
-            virtual uint8_t *getNumberOfTemperatureSensors() = 0;                               //      2 bytes         1 count
-            virtual uint8_t *getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) = 0;  //      2 bytes         0.1K
-            virtual uint8_t *getModuleChargeCurrent() = 0;                                      //      2 bytes         0.1A
-            virtual uint8_t *getModuleDischargeCurrent() = 0;                                   //      2 bytes         0.1A
-            virtual uint8_t *getModuleVoltage() = 0;                                            //      2 bytes         0.1V
-            virtual uint8_t *getStateOfCharge() = 0;                                            //      2 bytes         1%
-            virtual uint8_t *getModuleTotalCapacity() = 0;                                      //      4 bytes         1mAh
+            virtual uint16_t getNumberOfCells() = 0;                                            //      2 bytes         1 count
+            virtual uint16_t getCellVoltageOrNull(size_t cellNumber) = 0;                       //      2 bytes         0.1V
+            virtual uint16_t getNumberOfTemperatureSensors() = 0;                               //      2 bytes         1 count
+            virtual uint16_t getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) = 0;  //      2 bytes         0.1K
+            virtual uint16_t getModuleChargeCurrent() = 0;                                      //      2 bytes         0.1A
+            virtual uint16_t getModuleDischargeCurrent() = 0;                                   //      2 bytes         0.1A
+            virtual uint16_t getModuleVoltage() = 0;                                            //      2 bytes         0.1V
+            virtual uint16_t getStateOfCharge() = 0;                                            //      2 bytes         1%
+            virtual uint32_t getModuleTotalCapacity() = 0;                                      //      4 bytes         1mAh
 
             // BMS warning information inquiry
             // All reply with 2 bytes and only the LSB is set to one of:
@@ -34,26 +37,26 @@ namespace sdragos
             //      0x01 - Below normal
             //      0x02 - Above higher limit
             //      0xF0 - Other error
-            virtual uint8_t *getNumberOfCellsForWarningInfo() = 0;                              //      2 bytes         1 count
-            virtual uint8_t *getCellPairVoltageState(size_t oddCellNumber) = 0;
-            virtual uint8_t *getNumberOfTemperatureSensorsForWarningInfo() = 0;                 //      2 bytes         1 count
-            virtual uint8_t *getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) = 0;
-            virtual uint8_t *getModuleChargeVoltageState() = 0;
-            virtual uint8_t *getModuleDischargeVoltageState() = 0;
-            virtual uint8_t *getCellChargeVoltageState() = 0;
-            virtual uint8_t *getCellDischargeVoltageState() = 0;
-            virtual uint8_t *getModuleChargeCurrentState() = 0;
-            virtual uint8_t *getModuleDischargeCurrentState() = 0;
-            virtual uint8_t *getModuleChargeTemperatureState() = 0;
-            virtual uint8_t *getModuleDischargeTemperatureState() = 0;
-            virtual uint8_t *getCellChargeTemperatureState() = 0;
-            virtual uint8_t *getCellDischargeTemperatureState() = 0;
+            virtual uint16_t getNumberOfCellsForWarningInfo() = 0;                              //      2 bytes         1 count
+            virtual uint16_t getCellPairVoltageState(size_t oddCellNumber) = 0;
+            virtual uint16_t getNumberOfTemperatureSensorsForWarningInfo() = 0;                 //      2 bytes         1 count
+            virtual uint16_t getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) = 0;
+            virtual uint16_t getModuleChargeVoltageState() = 0;
+            virtual uint16_t getModuleDischargeVoltageState() = 0;
+            virtual uint16_t getCellChargeVoltageState() = 0;
+            virtual uint16_t getCellDischargeVoltageState() = 0;
+            virtual uint16_t getModuleChargeCurrentState() = 0;
+            virtual uint16_t getModuleDischargeCurrentState() = 0;
+            virtual uint16_t getModuleChargeTemperatureState() = 0;
+            virtual uint16_t getModuleDischargeTemperatureState() = 0;
+            virtual uint16_t getCellChargeTemperatureState() = 0;
+            virtual uint16_t getCellDischargeTemperatureState() = 0;
 
             // BMS charge and discharge information inquiry
-            virtual uint8_t *getChargeVoltageLimit() = 0;                                       //      2 bytes         0.1V
-            virtual uint8_t *getDischargeVoltageLimit() = 0;                                    //      2 bytes         0.1V
-            virtual uint8_t *getChargeCurrentLimit() = 0;                                       //      2 bytes         0.1A
-            virtual uint8_t *getDischargeCurrentLimit() = 0;                                    //      2 bytes         0.1A
+            virtual uint16_t getChargeVoltageLimit() = 0;                                       //      2 bytes         0.1V
+            virtual uint16_t getDischargeVoltageLimit() = 0;                                    //      2 bytes         0.1V
+            virtual uint16_t getChargeCurrentLimit() = 0;                                       //      2 bytes         0.1A
+            virtual uint16_t getDischargeCurrentLimit() = 0;                                    //      2 bytes         0.1A
             
             // returning 2 bytes, the LSB will be created by mixing flags
             // const uint8_t fullChargeRequest = 8;   // 0000 1000 Set when BMS needs battery fully charged
@@ -61,8 +64,24 @@ namespace sdragos
             // const uint8_t chargeImmediately = 32;  // 0010 0000 Set when SoC is very low, like 5~9%
             // const uint8_t dischargeEnable = 64;    // 0100 0000
             // const uint8_t chargeEnable = 128;      // 1000 0000
-            virtual uint8_t *getChargeDischargeStatus() = 0;                                    //      2 bytes         N/A
-            virtual uint8_t *getRuntimeToEmptySeconds() = 0;                                    //      2 bytes         1s
+            virtual uint16_t getChargeDischargeStatus() = 0;                                    //      2 bytes         N/A
+            virtual uint16_t getRuntimeToEmptySeconds() = 0;                                    //      2 bytes         1s
+
+            // Write data (0x10) requests are handed over one register at a time, in address order. Returns
+            // false when the register can't be written, which is also what adapters without writable
+            // registers do.
+            virtual bool writeRegister(uint16_t dataAddress, uint16_t value) { return false; }
+
+            // Registers a callback that is called each time a new data snapshot is available, so that
+            // replies can be prepared once per snapshot instead of once per request.
+            void addOnDataUpdatedCallback(std::function<void()> &&callback) { _onDataUpdatedCallback.add(std::move(callback)); }
+
+        protected:
+            // Implementations call this after they have finished updating their data.
+            void notifyDataUpdated() { _onDataUpdatedCallback.call(); }
+
+        private:
+            esphome::CallbackManager<void()> _onDataUpdatedCallback;
         }; // class BMSLibProtocolDataAdapter
     } // namespace mppsolar
 } // namespace sdragos
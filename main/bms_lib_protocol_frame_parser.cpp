@@ -0,0 +1,108 @@
+#include "bms_lib_protocol_frame_parser.h"
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        FrameParserResult BMSLibProtocolFrameParser::feed(uint8_t byte)
+        {
+            // Nothing in progress, so only the slave ID can start a frame
+            if (_candidateCount == 0 && byte != _slaveId)
+                return FrameParserResult::Incomplete;
+
+            const uint8_t position = _head++;
+            _ring[position] = byte;
+            _ring[position + RING_SIZE] = byte;
+
+            if (byte == _slaveId)
+            {
+                // The oldest candidate has gone on the longest without completing, a run of false write starts
+                // must not keep the real frame after them from being tracked
+                if (_candidateCount == MAX_CANDIDATES)
+                    removeCandidate(0);
+                _candidates[_candidateCount++] = Candidate{position, 0, 0, ModbusCrc16::INITIAL_VALUE};
+            }
+
+            size_t i = 0;
+            while (i < _candidateCount)
+            {
+                Candidate &candidate = _candidates[i];
+                candidate.crc = ModbusCrc16::update(candidate.crc, byte);
+                candidate.received++;
+
+                if (candidate.expectedLength == 0)
+                {
+                    const size_t expectedLength = expectedFrameLength(_ring + candidate.start, candidate.received);
+                    if (expectedLength == SIZE_MAX)
+                    {
+                        removeCandidate(i);
+                        continue;
+                    }
+                    candidate.expectedLength = expectedLength;
+                }
+
+                if (candidate.expectedLength != 0 && candidate.received == candidate.expectedLength)
+                {
+                    _frameStart = candidate.start;
+                    _frameLength = candidate.received;
+
+                    // Running the CRC over the received CRC too yields 0 for a valid frame
+                    if (candidate.crc == 0)
+                    {
+                        _candidateCount = 0;
+                        return FrameParserResult::Frame;
+                    }
+
+                    // A bad frame is only reported when nothing else could still turn out to be the real one
+                    if (_candidateCount == 1)
+                    {
+                        _candidateCount = 0;
+                        return FrameParserResult::InvalidCrc;
+                    }
+
+                    removeCandidate(i);
+                    continue;
+                }
+
+                i++;
+            }
+
+            return FrameParserResult::Incomplete;
+        }
+
+        void BMSLibProtocolFrameParser::reset()
+        {
+            _candidateCount = 0;
+        }
+
+        size_t BMSLibProtocolFrameParser::expectedFrameLength(const uint8_t *frame, size_t received)
+        {
+            if (received < 2)
+                return 0;
+
+            switch (frame[1])
+            {
+            case COMMAND_READ_DATA:
+                return READ_FRAME_SIZE;
+
+            case COMMAND_WRITE_DATA:
+                if (received < WRITE_FRAME_HEADER_SIZE)
+                    return 0;
+                if (frame[WRITE_FRAME_HEADER_SIZE - 1] > MAX_WRITE_BYTE_COUNT)
+                    return SIZE_MAX;
+                return WRITE_FRAME_HEADER_SIZE + frame[WRITE_FRAME_HEADER_SIZE - 1] + 2;
+
+            default:
+                return SIZE_MAX;
+            }
+        }
+
+        void BMSLibProtocolFrameParser::removeCandidate(size_t index)
+        {
+            // Only the candidate list shifts, the bytes stay where they are in the ring
+            for (size_t j = index; j + 1 < _candidateCount; j++)
+                _candidates[j] = _candidates[j + 1];
+            _candidateCount--;
+        }
+    } // namespace mppsolar
+} // namespace sdragos
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include "modbus_crc16.h"
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        enum class FrameParserResult
+        {
+            // More bytes are needed.
+            Incomplete,
+            // frame() holds a complete frame with a valid CRC.
+            Frame,
+            // frame() holds a complete frame with an invalid CRC, and no other frame is in progress.
+            InvalidCrc,
+        };
+
+        /// @brief Assembles Modbus RTU frames addressed to one slave from a byte stream.
+        ///        The frame length is derived from the function code (and the byte count of writes), so read
+        ///        and write frames can be mixed on the bus. Every byte equal to the slave ID starts a candidate
+        ///        frame with its own running CRC. A bounded number of candidates is tracked, which keeps the
+        ///        cost per byte constant, and a noise byte that looked like a frame start does not hide the
+        ///        real frame that follows it. When all are in use, a new start replaces the oldest one.
+        ///        Bytes are kept in a ring buffer that is larger than any frame, so dropping a candidate never
+        ///        moves data around. Every byte is also written one ring length further, which keeps any
+        ///        frame contiguous in memory even when it wraps around the end of the ring.
+        class BMSLibProtocolFrameParser
+        {
+        public:
+            static constexpr uint8_t COMMAND_READ_DATA = 0x03;
+            static constexpr uint8_t COMMAND_WRITE_DATA = 0x10;
+
+            // [id][fn][addrH][addrL][lenH][lenL][crcL][crcH]
+            static constexpr size_t READ_FRAME_SIZE = 8;
+            // [id][fn][addrH][addrL][lenH][lenL][byteCount] followed by the payload and the CRC
+            static constexpr size_t WRITE_FRAME_HEADER_SIZE = 7;
+            // Modbus limits a write to 123 registers
+            static constexpr size_t MAX_WRITE_BYTE_COUNT = 246;
+            static constexpr size_t MAX_FRAME_SIZE = WRITE_FRAME_HEADER_SIZE + MAX_WRITE_BYTE_COUNT + 2;
+
+            static constexpr size_t MAX_CANDIDATES = 4;
+
+            // Indexed with uint8_t, so positions wrap around without any arithmetic
+            static constexpr size_t RING_SIZE = 256;
+            static_assert(MAX_FRAME_SIZE < RING_SIZE, "A frame must fit in the ring buffer.");
+
+            explicit BMSLibProtocolFrameParser(uint8_t slaveId) : _slaveId(slaveId) {}
+
+            FrameParserResult feed(uint8_t byte);
+
+            // Valid after feed() returned Frame or InvalidCrc, until the next call to feed().
+            const uint8_t *frame() const { return _ring + _frameStart; }
+            size_t frameLength() const { return _frameLength; }
+
+            // True when no frame is in progress, so the incoming bytes are being skipped.
+            bool isIdle() const { return _candidateCount == 0; }
+
+            void reset();
+
+        private:
+            struct Candidate
+            {
+                uint8_t start;
+                uint16_t received;
+                // 0 until the function code (and for writes the byte count) has been received
+                uint16_t expectedLength;
+                uint16_t crc;
+            };
+
+            // Returns the frame length once the bytes received so far determine it, 0 when more bytes are
+            // needed and SIZE_MAX when the bytes can't be the start of a supported frame.
+            static size_t expectedFrameLength(const uint8_t *frame, size_t received);
+
+            void removeCandidate(size_t index);
+
+            const uint8_t _slaveId;
+
+            // The bytes since the start of the oldest candidate are never overwritten, as no candidate
+            // lives longer than MAX_FRAME_SIZE bytes.
+            uint8_t _ring[2 * RING_SIZE]{};
+            uint8_t _head = 0;
+
+            // Ordered by start, the oldest first
+            Candidate _candidates[MAX_CANDIDATES]{};
+            size_t _candidateCount = 0;
+
+            uint8_t _frameStart = 0;
+            size_t _frameLength = 0;
+        }; // class BMSLibProtocolFrameParser
+    } // namespace mppsolar
+} // namespace sdragos
@@ -9,146 +9,95 @@ namespace sdragos
             return true;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getBMSFirmwareVersion()
+        uint32_t BMSLibProtocolMockDataAdapter::getBMSFirmwareVersion()
         {
             // returns 4 bytes
-            auto reply = new uint8_t[4];
-            reply[0] = 0;
-            reply[1] = 0;
-            reply[2] = 0;
-            reply[3] = 1;
-            return reply;
+            return 1;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getBMSHardwareVersion()
+        uint32_t BMSLibProtocolMockDataAdapter::getBMSHardwareVersion()
         {
             // returns 4 bytes
-            auto reply = new uint8_t[4];
-            reply[0] = 0;
-            reply[1] = 0;
-            reply[2] = 0;
-            reply[3] = 1;
-            return reply;
+            return 1;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getNumberOfCells()
+        uint16_t BMSLibProtocolMockDataAdapter::getNumberOfCells()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 8; // 8 cells
-            return reply;
+            return 8; // 8 cells
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getCellVoltageOrNull(size_t cellNumber)
+        uint16_t BMSLibProtocolMockDataAdapter::getCellVoltageOrNull(size_t cellNumber)
         {
             // 3.327V --> 33V --- bad precision
             // value * 0.1V
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 33;
-            return reply;
+            return 33;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getNumberOfTemperatureSensors()
+        uint16_t BMSLibProtocolMockDataAdapter::getNumberOfTemperatureSensors()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 3; // 3 sensors
-            return reply;
+            return 3; // 3 sensors
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getTemperatureOfSensorOrNull(size_t temperatureSensorNumber)
+        uint16_t BMSLibProtocolMockDataAdapter::getTemperatureOfSensorOrNull(size_t temperatureSensorNumber)
         {
             uint16_t kelvin = 2931; // ((273.15 + 20Celsius)*100)/10
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(kelvin >> 8);
-            reply[1] = (uint8_t)kelvin;
-            return reply;
+            return kelvin;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleChargeCurrent()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleChargeCurrent()
         {
             uint16_t amps = 572; // 57.2A * 10 (returning divisions of 0.1A)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(amps >> 8);
-            reply[1] = (uint8_t)amps;
-            return reply;
+            return amps;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleDischargeCurrent()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleDischargeCurrent()
         {
             uint16_t amps = 900; // 90A * 10 (returning divisions of 0.1A)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(amps >> 8);
-            reply[1] = (uint8_t)amps;
-            return reply;
+            return amps;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleVoltage()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleVoltage()
         {
             uint16_t volts = 264; // 26.4V * 10 (returning divisions of 0.1V)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(volts >> 8);
-            reply[1] = (uint8_t)volts;
-            return reply;
+            return volts;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getStateOfCharge()
+        uint16_t BMSLibProtocolMockDataAdapter::getStateOfCharge()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0x00;
-            reply[1] = 70; // 70% charged
-            return reply;
+            return 70; // 70% charged
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleTotalCapacity()
+        uint32_t BMSLibProtocolMockDataAdapter::getModuleTotalCapacity()
         {
             uint32_t milliAmpHours = 280000; // 280Ah * 1000 (returning divisions of 1 mAh)
-            auto reply = new uint8_t[4];
-            reply[0] = (uint8_t)(milliAmpHours >> 24);
-            reply[1] = (uint8_t)(milliAmpHours >> 16);
-            reply[2] = (uint8_t)(milliAmpHours >> 8);
-            reply[3] = (uint8_t)milliAmpHours;
-            return reply;
+            return milliAmpHours;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getChargeVoltageLimit()
+        uint16_t BMSLibProtocolMockDataAdapter::getChargeVoltageLimit()
         {
             uint16_t amps = 292; // 29.2V * 10 (returning divisions of 0.1V)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(amps >> 8);
-            reply[1] = (uint8_t)amps;
-            return reply;
+            return amps;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getDischargeVoltageLimit()
+        uint16_t BMSLibProtocolMockDataAdapter::getDischargeVoltageLimit()
         {
             uint16_t amps = 200; // 20V * 10 (returning divisions of 0.1V)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(amps >> 8);
-            reply[1] = (uint8_t)amps;
-            return reply;
+            return amps;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getChargeCurrentLimit()
+        uint16_t BMSLibProtocolMockDataAdapter::getChargeCurrentLimit()
         {
             uint16_t amps = 1400; // 140A * 10 (returning divisions of 0.1A)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(amps >> 8);
-            reply[1] = (uint8_t)amps;
-            return reply;
+            return amps;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getDischargeCurrentLimit()
+        uint16_t BMSLibProtocolMockDataAdapter::getDischargeCurrentLimit()
         {
             uint16_t amps = 3400; // 340A * 10 (returning divisions of 0.1A)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(amps >> 8);
-            reply[1] = (uint8_t)amps;
-            return reply;
+            return amps;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getChargeDischargeStatus()
+        uint16_t BMSLibProtocolMockDataAdapter::getChargeDischargeStatus()
         {                                          // returning 2 bytes, the LSB will be created by mixing flags
             const uint8_t fullChargeRequest = 8;   // 0000 1000 Set when BMS needs battery fully charged
             const uint8_t chargeImmediately2 = 16; // 0001 0000 Set when SoC is low, like 10~14%
@@ -156,131 +105,83 @@ namespace sdragos
             const uint8_t dischargeEnable = 64;    // 0100 0000
             const uint8_t chargeEnable = 128;      // 1000 0000
 
-            auto reply = new uint8_t[2];
-            reply[0] = 0x00;
-            reply[1] = chargeEnable | dischargeEnable;
-            return reply;
+            return chargeEnable | dischargeEnable;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getRuntimeToEmptySeconds()
+        uint16_t BMSLibProtocolMockDataAdapter::getRuntimeToEmptySeconds()
         {
             uint16_t seconds = 1200; // 20 hours * 60 (returning Seconds)
-            auto reply = new uint8_t[2];
-            reply[0] = (uint8_t)(seconds >> 8);
-            reply[1] = (uint8_t)seconds;
-            return reply;
+            return seconds;
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getNumberOfCellsForWarningInfo()
+        uint16_t BMSLibProtocolMockDataAdapter::getNumberOfCellsForWarningInfo()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 8; // 8 cells
-            return reply;
+            return 8; // 8 cells
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getCellPairVoltageState(size_t oddCellNumber)
+        uint16_t BMSLibProtocolMockDataAdapter::getCellPairVoltageState(size_t oddCellNumber)
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal state
-            return reply;
+            return 0x00; // Normal state
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getNumberOfTemperatureSensorsForWarningInfo()
+        uint16_t BMSLibProtocolMockDataAdapter::getNumberOfTemperatureSensorsForWarningInfo()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 4; // 4 sensors
-            return reply;
+            return 4; // 4 sensors
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getTemperatureSensorPairState(size_t oddTemperatureSensorNumber)
+        uint16_t BMSLibProtocolMockDataAdapter::getTemperatureSensorPairState(size_t oddTemperatureSensorNumber)
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x01; // below normal
-            return reply;
+            return 0x01; // below normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleChargeVoltageState()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleChargeVoltageState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleDischargeVoltageState()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleDischargeVoltageState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getCellChargeVoltageState()
+        uint16_t BMSLibProtocolMockDataAdapter::getCellChargeVoltageState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getCellDischargeVoltageState()
+        uint16_t BMSLibProtocolMockDataAdapter::getCellDischargeVoltageState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0xF0; // Other error
-            return reply;
+            return 0xF0; // Other error
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleChargeCurrentState()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleChargeCurrentState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleDischargeCurrentState()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleDischargeCurrentState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x02; // Above higher limit
-            return reply;
+            return 0x02; // Above higher limit
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleChargeTemperatureState()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleChargeTemperatureState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getModuleDischargeTemperatureState()
+        uint16_t BMSLibProtocolMockDataAdapter::getModuleDischargeTemperatureState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getCellChargeTemperatureState()
+        uint16_t BMSLibProtocolMockDataAdapter::getCellChargeTemperatureState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x00; // Normal
-            return reply;
+            return 0x00; // Normal
         }
 
-        uint8_t * BMSLibProtocolMockDataAdapter::getCellDischargeTemperatureState()
+        uint16_t BMSLibProtocolMockDataAdapter::getCellDischargeTemperatureState()
         {
-            auto reply = new uint8_t[2];
-            reply[0] = 0;
-            reply[1] = 0x02; // Above higher limit
-            return reply;
+            return 0x02; // Above higher limit
         }
     } // namespace mppsolar
 } // namespace sdragos
\ No newline at end of file
@@ -16,19 +16,19 @@ namespace sdragos
                 bool hasUpdatedData() override;
 
                 // Version information
-                uint8_t *getBMSFirmwareVersion() override;
-                uint8_t *getBMSHardwareVersion() override;
+                uint32_t getBMSFirmwareVersion() override;
+                uint32_t getBMSHardwareVersion() override;
 
                 // BMS general status
-                uint8_t *getNumberOfCells() override;
-                uint8_t *getCellVoltageOrNull(size_t cellNumber) override;
-                uint8_t *getNumberOfTemperatureSensors() override;
-                uint8_t *getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) override;
-                uint8_t *getModuleChargeCurrent() override;
-                uint8_t *getModuleDischargeCurrent() override;
-                uint8_t *getModuleVoltage() override;
-                uint8_t *getStateOfCharge() override;
-                uint8_t *getModuleTotalCapacity() override;
+                uint16_t getNumberOfCells() override;
+                uint16_t getCellVoltageOrNull(size_t cellNumber) override;
+                uint16_t getNumberOfTemperatureSensors() override;
+                uint16_t getTemperatureOfSensorOrNull(size_t temperatureSensorNumber) override;
+                uint16_t getModuleChargeCurrent() override;
+                uint16_t getModuleDischargeCurrent() override;
+                uint16_t getModuleVoltage() override;
+                uint16_t getStateOfCharge() override;
+                uint32_t getModuleTotalCapacity() override;
 
                 // BMS warning information inquiry
                 // All reply with 2 bytes and only the LSB is set to one of:
@@ -36,28 +36,28 @@ namespace sdragos
                 //      0x01 - Below normal
                 //      0x02 - Above higher limit
                 //      0xF0 - Other error
-                uint8_t *getNumberOfCellsForWarningInfo() override;
-                uint8_t *getCellPairVoltageState(size_t oddCellNumber) override;
-                uint8_t *getNumberOfTemperatureSensorsForWarningInfo() override;
-                uint8_t *getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) override;
-                uint8_t *getModuleChargeVoltageState() override;
-                uint8_t *getModuleDischargeVoltageState() override;
-                uint8_t *getCellChargeVoltageState() override;
-                uint8_t *getCellDischargeVoltageState() override;
-                uint8_t *getModuleChargeCurrentState() override;
-                uint8_t *getModuleDischargeCurrentState() override;
-                uint8_t *getModuleChargeTemperatureState() override;
-                uint8_t *getModuleDischargeTemperatureState() override;
-                uint8_t *getCellChargeTemperatureState() override;
-                uint8_t *getCellDischargeTemperatureState() override;
+                uint16_t getNumberOfCellsForWarningInfo() override;
+                uint16_t getCellPairVoltageState(size_t oddCellNumber) override;
+                uint16_t getNumberOfTemperatureSensorsForWarningInfo() override;
+                uint16_t getTemperatureSensorPairState(size_t oddTemperatureSensorNumber) override;
+                uint16_t getModuleChargeVoltageState() override;
+                uint16_t getModuleDischargeVoltageState() override;
+                uint16_t getCellChargeVoltageState() override;
+                uint16_t getCellDischargeVoltageState() override;
+                uint16_t getModuleChargeCurrentState() override;
+                uint16_t getModuleDischargeCurrentState() override;
+                uint16_t getModuleChargeTemperatureState() override;
+                uint16_t getModuleDischargeTemperatureState() override;
+                uint16_t getCellChargeTemperatureState() override;
+                uint16_t getCellDischargeTemperatureState() override;
 
                 // BMS charge and discharge information inquiry
-                uint8_t *getChargeVoltageLimit() override;
-                uint8_t *getDischargeVoltageLimit() override;
-                uint8_t *getChargeCurrentLimit() override;
-                uint8_t *getDischargeCurrentLimit() override;
-                uint8_t *getChargeDischargeStatus() override;
-                uint8_t *getRuntimeToEmptySeconds() override;
+                uint16_t getChargeVoltageLimit() override;
+                uint16_t getDischargeVoltageLimit() override;
+                uint16_t getChargeCurrentLimit() override;
+                uint16_t getDischargeCurrentLimit() override;
+                uint16_t getChargeDischargeStatus() override;
+                uint16_t getRuntimeToEmptySeconds() override;
         };
     }// namespace mppsolar
 }// namespace sdragos
\ No newline at end of file
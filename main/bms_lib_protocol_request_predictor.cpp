@@ -0,0 +1,82 @@
+#include "bms_lib_protocol_request_predictor.h"
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        void BMSLibProtocolRequestPredictor::observe(const ReadRequest &request)
+        {
+            if (_hasPrevious)
+            {
+                Entry *entry = find(_previous);
+                if (entry == nullptr)
+                {
+                    // The slot of the set with the lower confidence is taken once it has lost it. Another
+                    // request that only shows up now and then doesn't evict one of the polling cycle.
+                    Entry *set = &_table[indexOf(_previous)];
+                    Entry *slot = set;
+                    for (size_t way = 1; way < WAYS; way++)
+                    {
+                        if (set[way].confidence < slot->confidence)
+                            slot = &set[way];
+                    }
+                    if (slot->confidence == 0)
+                        *slot = Entry{_previous, request, 1};
+                    else
+                        slot->confidence--;
+                }
+                else if (entry->next == request)
+                {
+                    if (entry->confidence < MAX_CONFIDENCE)
+                        entry->confidence++;
+                }
+                else
+                {
+                    // A different successor, it only replaces the learned one after repeated misses
+                    if (--entry->confidence == 0)
+                        *entry = Entry{_previous, request, 1};
+                }
+            }
+
+            _previous = request;
+            _hasPrevious = true;
+        }
+
+        bool BMSLibProtocolRequestPredictor::predictNext(ReadRequest &next) const
+        {
+            if (!_hasPrevious)
+                return false;
+
+            const Entry *entry = find(_previous);
+            if (entry == nullptr || entry->confidence < MIN_CONFIDENCE)
+                return false;
+
+            next = entry->next;
+            return true;
+        }
+
+        BMSLibProtocolRequestPredictor::Entry *BMSLibProtocolRequestPredictor::find(const ReadRequest &request)
+        {
+            Entry *set = &_table[indexOf(request)];
+            for (size_t way = 0; way < WAYS; way++)
+            {
+                if (set[way].confidence != 0 && set[way].request == request)
+                    return &set[way];
+            }
+            return nullptr;
+        }
+
+        const BMSLibProtocolRequestPredictor::Entry *BMSLibProtocolRequestPredictor::find(const ReadRequest &request) const
+        {
+            return const_cast<BMSLibProtocolRequestPredictor *>(this)->find(request);
+        }
+
+        size_t BMSLibProtocolRequestPredictor::indexOf(const ReadRequest &request)
+        {
+            // The low byte of the address tells most requests apart, the page and the length are folded in
+            // so the cell pages and block reads don't all land on the same set
+            const size_t hash = request.dataAddress ^ (request.dataAddress >> 5) ^ (request.dataLength << 3);
+            return (hash * WAYS) & (TABLE_SIZE - WAYS);
+        }
+    } // namespace mppsolar
+} // namespace sdragos
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <array>
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        // A read request, identified by its start address and number of registers.
+        struct ReadRequest
+        {
+            uint16_t dataAddress;
+            uint16_t dataLength;
+
+            bool operator==(const ReadRequest &other) const { return dataAddress == other.dataAddress && dataLength == other.dataLength; }
+        };
+
+        /// @brief Learns which read request follows which in the inverter polling sequence.
+        ///        The inverters poll the same addresses in the same order over and over, so the request that
+        ///        followed a request last time is a good guess for the next time. The table keeps one successor
+        ///        per request with a small saturating confidence, which makes a single out of order request
+        ///        not unlearn the usual sequence.
+        ///        Requests are hashed into a fixed two-way set associative table, so there are no allocations
+        ///        and both learning and predicting take constant time. Two requests of a polling cycle that hash
+        ///        to the same set each keep a slot of it.
+        class BMSLibProtocolRequestPredictor
+        {
+        public:
+            // A power of 2, more than the distinct requests an inverter polls in one round
+            static constexpr size_t TABLE_SIZE = 128;
+            static constexpr size_t WAYS = 2;
+            static constexpr uint8_t MAX_CONFIDENCE = 3;
+            // Successors with a lower confidence are not predicted
+            static constexpr uint8_t MIN_CONFIDENCE = 1;
+
+            // Records that request came right after the previously observed one.
+            void observe(const ReadRequest &request);
+
+            // Returns true and sets next when a successor of the last observed request is known.
+            bool predictNext(ReadRequest &next) const;
+
+            // Forgets the last observed request, so the next one does not train a successor. Used when the
+            // sequence was interrupted, for example by a frame that was not replied to.
+            void breakSequence() { _hasPrevious = false; }
+
+        protected:
+            // The first slot of the set the request is kept in
+            static size_t indexOf(const ReadRequest &request);
+
+        private:
+            struct Entry
+            {
+                ReadRequest request;
+                ReadRequest next;
+                uint8_t confidence;
+            };
+
+            // The entry of the request, nullptr when it has none
+            Entry *find(const ReadRequest &request);
+            const Entry *find(const ReadRequest &request) const;
+
+            std::array<Entry, TABLE_SIZE> _table{};
+            ReadRequest _previous{};
+            bool _hasPrevious = false;
+        }; // class BMSLibProtocolRequestPredictor
+    } // namespace mppsolar
+} // namespace sdragos
@@ -1,6 +1,9 @@
 #define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
 
 #include "bms_lib_protocol_uart_handler.h"
+#include <algorithm>
+#include "esp_rom_sys.h"
+#include "freertos/task.h"
 
 using namespace esphome;
 using namespace uart;
@@ -9,79 +12,104 @@ namespace sdragos
 {
     namespace mppsolar
     {
-        BMSLibProtocolUARTHandler::BMSLibProtocolUARTHandler(UARTComponent *parent) : UARTDevice(parent){
+        constexpr BMSLibProtocolUARTHandler::DispatchTable BMSLibProtocolUARTHandler::buildDispatchTable()
+        {
+            DispatchTable table{};
+
             // Setting up functions that will be used to reply to ReadData device queries
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0001] = &BMSLibProtocolUARTHandler::replyForProtocolType;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0002] = &BMSLibProtocolUARTHandler::replyForProtocolVersion;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0003] = &BMSLibProtocolUARTHandler::replyForBMSFirmwareVersion;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0005] = &BMSLibProtocolUARTHandler::replyForBMSHardwareVersion;
-
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0010] = &BMSLibProtocolUARTHandler::replyForNumberOfCellsRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0025] = &BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensors;
-
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0030] = &BMSLibProtocolUARTHandler::replyForModuleChargeCurrentRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0031] = &BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0032] = &BMSLibProtocolUARTHandler::replyForModuleVoltageRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0033] = &BMSLibProtocolUARTHandler::replyForStateOfChargeRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0034] = &BMSLibProtocolUARTHandler::replyForModuleTotalCapacityRequest;
-
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0040] = &BMSLibProtocolUARTHandler::replyForNumberOfCellsWarningInfoRequest;
-
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0050] = &BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensorsWarningInfoRequest;
-
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0060] = &BMSLibProtocolUARTHandler::replyForModuleChargeVoltageStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0061] = &BMSLibProtocolUARTHandler::replyForModuleDischargeVoltageStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0062] = &BMSLibProtocolUARTHandler::replyForCellChargeVoltageStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0063] = &BMSLibProtocolUARTHandler::replyForCellDischargeVoltageStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0064] = &BMSLibProtocolUARTHandler::replyForModuleChargeCurrentStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0065] = &BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0066] = &BMSLibProtocolUARTHandler::replyForModuleChargeTemperatureStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0067] = &BMSLibProtocolUARTHandler::replyForModuleDischargeTemperatureStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0068] = &BMSLibProtocolUARTHandler::replyForCellChargeTemperatureStateRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0069] = &BMSLibProtocolUARTHandler::replyForCellDischargeTemperatureStateRequest;
-
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0070] = &BMSLibProtocolUARTHandler::replyForChargeVoltageLimitRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0071] = &BMSLibProtocolUARTHandler::replyForDischargeVoltageLimitRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0072] = &BMSLibProtocolUARTHandler::replyForChargeCurrentLimitRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0073] = &BMSLibProtocolUARTHandler::replyForDischargeCurrentLimitRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0074] = &BMSLibProtocolUARTHandler::replyForChargeDischargeStatusRequest;
-            _mapDataAddressToReplyToRequestNoParamFunc[0x0075] = &BMSLibProtocolUARTHandler::replyForRuntimeToEmptyRequest;
-
-            for (uint16_t i = 0x0000; i <= 0x000F; i++)
-            {
-                for (uint16_t j = 0x0011; j <= 0x0024; j++)
+            table[0x01].noParamFunc = &BMSLibProtocolUARTHandler::replyForProtocolType;
+            table[0x02].noParamFunc = &BMSLibProtocolUARTHandler::replyForProtocolVersion;
+            table[0x03].noParamFunc = &BMSLibProtocolUARTHandler::replyForBMSFirmwareVersion;
+            table[0x05].noParamFunc = &BMSLibProtocolUARTHandler::replyForBMSHardwareVersion;
+
+            table[0x10].noParamFunc = &BMSLibProtocolUARTHandler::replyForNumberOfCellsRequest;
+            table[0x25].noParamFunc = &BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensors;
+
+            table[0x30].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleChargeCurrentRequest;
+            table[0x31].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentRequest;
+            table[0x32].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleVoltageRequest;
+            table[0x33].noParamFunc = &BMSLibProtocolUARTHandler::replyForStateOfChargeRequest;
+            table[0x34].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleTotalCapacityRequest;
+
+            table[0x40].noParamFunc = &BMSLibProtocolUARTHandler::replyForNumberOfCellsWarningInfoRequest;
+
+            table[0x50].noParamFunc = &BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensorsWarningInfoRequest;
+
+            table[0x60].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleChargeVoltageStateRequest;
+            table[0x61].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleDischargeVoltageStateRequest;
+            table[0x62].noParamFunc = &BMSLibProtocolUARTHandler::replyForCellChargeVoltageStateRequest;
+            table[0x63].noParamFunc = &BMSLibProtocolUARTHandler::replyForCellDischargeVoltageStateRequest;
+            table[0x64].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleChargeCurrentStateRequest;
+            table[0x65].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentStateRequest;
+            table[0x66].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleChargeTemperatureStateRequest;
+            table[0x67].noParamFunc = &BMSLibProtocolUARTHandler::replyForModuleDischargeTemperatureStateRequest;
+            table[0x68].noParamFunc = &BMSLibProtocolUARTHandler::replyForCellChargeTemperatureStateRequest;
+            table[0x69].noParamFunc = &BMSLibProtocolUARTHandler::replyForCellDischargeTemperatureStateRequest;
+
+            table[0x70].noParamFunc = &BMSLibProtocolUARTHandler::replyForChargeVoltageLimitRequest;
+            table[0x71].noParamFunc = &BMSLibProtocolUARTHandler::replyForDischargeVoltageLimitRequest;
+            table[0x72].noParamFunc = &BMSLibProtocolUARTHandler::replyForChargeCurrentLimitRequest;
+            table[0x73].noParamFunc = &BMSLibProtocolUARTHandler::replyForDischargeCurrentLimitRequest;
+            table[0x74].noParamFunc = &BMSLibProtocolUARTHandler::replyForChargeDischargeStatusRequest;
+            table[0x75].noParamFunc = &BMSLibProtocolUARTHandler::replyForRuntimeToEmptyRequest;
+
+            for (uint16_t j = 0x0011; j <= 0x0024; j++)
+                table[j].dataAddressFunc = &BMSLibProtocolUARTHandler::replyForCellVoltageRequest;
+
+            for (uint16_t j = 0x0026; j <= 0x002F; j++)
+                table[j].dataAddressFunc = &BMSLibProtocolUARTHandler::replyForTemperatureRequest;
+
+            for (uint16_t j = 0x0041; j <= 0x004A; j++)
+                table[j].dataAddressFunc = &BMSLibProtocolUARTHandler::replyForCellPairVoltageStateRequest;
+
+            for (uint16_t j = 0x0051; j <= 0x0055; j++)
+                table[j].dataAddressFunc = &BMSLibProtocolUARTHandler::replyForTemperatureSensorPairStateRequest;
+
+            // Only the protocol type and version can be answered without BMS data
+            for (size_t i = 0; i < DISPATCH_TABLE_SIZE; i++)
+                table[i].requiresData = true;
+            table[0x01].requiresData = false;
+            table[0x02].requiresData = false;
+
+            // Assign the reply cache slots, one per fixed address and one per page for the others, and the
+            // latency statistics, one per supported low byte
+            uint16_t slot = 0;
+            uint8_t statsIndex = 0;
+            for (size_t i = 0; i < DISPATCH_TABLE_SIZE; i++)
+            {
+                if (table[i].noParamFunc != nullptr || table[i].dataAddressFunc != nullptr)
+                    table[i].statsIndex = statsIndex++;
+                if (table[i].noParamFunc != nullptr)
+                    table[i].noParamReplySlot = slot++;
+                if (table[i].dataAddressFunc != nullptr)
                 {
-                    uint16_t addr = (i << 8) | j;
-                    _mapDataAddressToReplyToRequestDataAddressFunc[addr] = &BMSLibProtocolUARTHandler::replyForCellVoltageRequest;
+                    table[i].dataAddressReplySlot = slot;
+                    slot += DISPATCH_TABLE_MAX_PAGE + 1;
                 }
             }
 
-            for (uint16_t i = 0x0000; i <= 0x000F; i++)
-            {
-                for (uint16_t j = 0x0026; j <= 0x002F; j++)
-                {
-                    uint16_t addr = (i << 8) | j;
-                    _mapDataAddressToReplyToRequestDataAddressFunc[addr] = &BMSLibProtocolUARTHandler::replyForTemperatureRequest;
-                }
-            }
+            return table;
+        }
 
-            for (uint16_t i = 0x0000; i <= 0x000F; i++)
-            {
-                for (uint16_t j = 0x0041; j <= 0x004A; j++)
-                {
-                    uint16_t addr = (i << 8) | j;
-                    _mapDataAddressToReplyToRequestDataAddressFunc[addr] = &BMSLibProtocolUARTHandler::replyForCellPairVoltageStateRequest;
-                }
-            }
+        // Built at compile time, so it is placed in flash and needs no heap.
+        constexpr BMSLibProtocolUARTHandler::DispatchTable BMSLibProtocolUARTHandler::_dispatchTable =
+            BMSLibProtocolUARTHandler::buildDispatchTable();
 
-            for (uint16_t i = 0x0000; i <= 0x000F; i++)
+        constexpr size_t BMSLibProtocolUARTHandler::countAddresses(const DispatchTable &table, bool paged)
+        {
+            size_t count = 0;
+            for (const auto &entry : table)
             {
-                for (uint16_t j = 0x0051; j <= 0x0055; j++)
-                {
-                    uint16_t addr = (i << 8) | j;
-                    _mapDataAddressToReplyToRequestDataAddressFunc[addr] = &BMSLibProtocolUARTHandler::replyForTemperatureSensorPairStateRequest;
-                }
+                if ((paged ? entry.dataAddressFunc != nullptr : entry.noParamFunc != nullptr))
+                    count++;
             }
+            return count;
+        }
+
+        BMSLibProtocolUARTHandler::BMSLibProtocolUARTHandler(UARTComponent *parent) : UARTDevice(parent){
+            _statsLock = xSemaphoreCreateMutex();
+            // The protocol type and version do not need a data adapter
+            rebuildReplyCache();
         }
 
         void BMSLibProtocolUARTHandler::setup()
@@ -90,26 +118,195 @@ namespace sdragos
             ESP_LOGE("BMSLibProtocolUARTHandler", "Test error message.");
             ESP_LOGW("BMSLibProtocolUARTHandler", "Test warning message.");
             ESP_LOGI("BMSLibProtocolUARTHandler", "Test information message.");
+
+            _interFrameSilenceUs = calculateInterFrameSilenceUs();
+            const uint32_t baudRate = this->parent_->get_baud_rate();
+            _characterTimeUs = baudRate != 0 ? bitsPerCharacter() * 1000000UL / baudRate : 0;
+            ESP_LOGI("BMSLibProtocolUARTHandler", "Inter-frame silence: %lu us", _interFrameSilenceUs);
+        }
+
+        void BMSLibProtocolUARTHandler::dump_config()
+        {
+            ESP_LOGI("BMSLibProtocolUARTHandler", "BMSLibProtocolUARTHandler:");
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  Frame completion: %s",
+                     _frameCompletionMode == FrameCompletionMode::FixedDelay ? "fixed delay" : "inter-frame silence");
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  Inter-frame silence: %lu us", _interFrameSilenceUs);
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  Request prediction: %s", _requestPredictionEnabled ? "enabled" : "disabled");
+            dumpStats();
+        }
+
+        const BMSLibProtocolUARTHandler::Stats &BMSLibProtocolUARTHandler::getStats()
+        {
+            // Called from other tasks than the handler one, which publishes its statistics between frames
+            xSemaphoreTake(_statsLock, portMAX_DELAY);
+            _statsSnapshot = _publishedStats;
+            xSemaphoreGive(_statsLock);
+            return _statsSnapshot;
+        }
+
+        void BMSLibProtocolUARTHandler::publishStats()
+        {
+            xSemaphoreTake(_statsLock, portMAX_DELAY);
+            _publishedStats = _stats;
+            xSemaphoreGive(_statsLock);
+        }
+
+        void BMSLibProtocolUARTHandler::dumpStats()
+        {
+            const Stats &stats = getStats();
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  Frames: %lu received, %lu invalid CRC, %lu interrupted",
+                     stats.framesReceived, stats.crcFailures, stats.interruptedFrames);
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  UART: %lu receive overflows, %lu line errors", stats.rxOverflows, stats.lineErrors);
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  Not replied: %lu unsupported address, %lu no recent data, %lu suppressed",
+                     stats.unsupportedAddresses, stats.staleDataNoReplies, stats.suppressedReplies);
+
+            const LatencyHistogram &all = stats.replyLatency;
+            ESP_LOGI("BMSLibProtocolUARTHandler", "  Reply latency: %lu replies, p50 %lu us, p90 %lu us, p99 %lu us, max %lu us",
+                     all.count(), all.percentileUs(50), all.percentileUs(90), all.percentileUs(99), all.maxUs());
+
+            if (_requestPredictionEnabled)
+            {
+                const LatencyHistogram &predicted = stats.predictedReplyLatency;
+                const uint32_t predictions = stats.predictedReplies + stats.mispredictedRequests;
+                ESP_LOGI("BMSLibProtocolUARTHandler", "  Predicted replies: %lu hits, %lu misses (%lu%% hit rate), %llu us of encoding saved",
+                         stats.predictedReplies, stats.mispredictedRequests,
+                         predictions != 0 ? (uint32_t)((uint64_t)stats.predictedReplies * 100 / predictions) : 0,
+                         stats.predictionSavedUs);
+                ESP_LOGI("BMSLibProtocolUARTHandler", "  Predicted reply latency: p50 %lu us, p90 %lu us, p99 %lu us, max %lu us",
+                         predicted.percentileUs(50), predicted.percentileUs(90), predicted.percentileUs(99), predicted.maxUs());
+            }
+
+            for (size_t lowByte = 0; lowByte < DISPATCH_TABLE_SIZE; lowByte++)
+            {
+                const DispatchEntry &entry = _dispatchTable[lowByte];
+                if (entry.noParamFunc == nullptr && entry.dataAddressFunc == nullptr)
+                    continue;
+
+                const LatencyHistogram &histogram = stats.replyLatencyPerAddress[entry.statsIndex];
+                if (histogram.count() == 0)
+                    continue;
+
+                ESP_LOGI("BMSLibProtocolUARTHandler", "    0x%02X: %lu replies, p50 %lu us, p99 %lu us, max %lu us",
+                         lowByte, histogram.count(), histogram.percentileUs(50), histogram.percentileUs(99), histogram.maxUs());
+            }
         }
 
         void BMSLibProtocolUARTHandler::loop()
         {
-            if (readLatestIncoming8BytesFrame(SLAVE_ID))
+            // The statistics only change when bytes were read, the copy is taken once the frame is done with
+            const int64_t lastByteReceivedAtUs = _lastByteReceivedAtUs;
+            serviceFrame();
+            if (_lastByteReceivedAtUs != lastByteReceivedAtUs)
+                publishStats();
+        }
+
+        void BMSLibProtocolUARTHandler::serviceFrame()
+        {
+            FrameParserResult result = readIncomingFrame();
+            if (result == FrameParserResult::Incomplete)
+            {
+                // Nothing is being received, so there's time to prepare the reply to the next request
+                if (_requestPredictionEnabled && _frameParser.isIdle())
+                    stageNextReply();
+                return;
+            }
+
+            if (_frameCompletionMode == FrameCompletionMode::FixedDelay)
             {
                 vTaskDelay(100 / portTICK_PERIOD_MS); //wait 100ms before processing
-                checkAndProcessLatest8BytesFrame();
+            }
+            else if (!waitForInterFrameSilence())
+            {
+                // More bytes arrived before the silence that ends a frame, so the inverter is already
+                // sending something else. The parser starts over with those bytes on the next call.
+                _stats.interruptedFrames++;
+                _predictor.breakSequence();
+                return;
+            }
+
+            if (result == FrameParserResult::InvalidCrc)
+            {
+                ESP_LOGE("BMSLibProtocolUARTHandler", "%s", "Invalid CRC.");
+                _stats.crcFailures++;
+                // The request it was is unknown, the one after it must not be learned as the next of the last
+                _predictor.breakSequence();
+                sendInvalidCrcReply();
+                return;
+            }
+
+            processFrame(_frameParser.frame(), _frameParser.frameLength());
+        }
+
+        void BMSLibProtocolUARTHandler::runOnUartEvents(IDFUARTComponent *uart)
+        {
+            uart->set_rx_timeout(RX_TIMEOUT_CHARACTERS);
+            const uint32_t baudRate = this->parent_->get_baud_rate();
+            const uint32_t rxTimeoutUs = baudRate != 0 ? RX_TIMEOUT_CHARACTERS * bitsPerCharacter() * 1000000UL / baudRate : 0;
+            QueueHandle_t eventQueue = *uart->get_uart_event_queue();
+
+            while (true)
+            {
+                uart_event_t event;
+                if (xQueueReceive(eventQueue, &event, IDLE_WAIT_TICKS) != pdTRUE)
+                {
+                    // Nothing received, loop() uses the time to stage the next reply
+                    loop();
+                    continue;
+                }
 
-                // this resets the buffer, so that we don't process the same frame multiple times
-                _rxBufferIndex = 0;
+                switch (event.type)
+                {
+                case UART_DATA:
+                    if (event.timeout_flag)
+                    {
+                        _pendingRxIdleUs = rxTimeoutUs;
+                        _pendingRxIdleBytes = event.size;
+                    }
+                    loop();
+                    // The idle time belongs to the bytes of this event only. When loop() didn't get to read
+                    // them, it must not be applied to whatever is read later.
+                    _pendingRxIdleUs = 0;
+                    break;
+
+                case UART_FIFO_OVF:
+                case UART_BUFFER_FULL:
+                    // Bytes were lost, so what is buffered can't be trusted to form the frame it looks like
+                    ESP_LOGW("BMSLibProtocolUARTHandler", "%s", "UART receive overflow. Dropping the received bytes.");
+                    _stats.rxOverflows++;
+                    publishStats();
+                    _predictor.breakSequence();
+                    uart->flush_input();
+                    _frameParser.reset();
+                    break;
+
+                case UART_BREAK:
+                case UART_FRAME_ERR:
+                case UART_PARITY_ERR:
+                    // The frame in progress is corrupt, start over with the bytes that follow
+                    _stats.lineErrors++;
+                    publishStats();
+                    _predictor.breakSequence();
+                    _frameParser.reset();
+                    break;
+
+                default:
+                    break;
+                }
             }
         }
 
         void BMSLibProtocolUARTHandler::setDataAdapter(BMSLibProtocolDataAdapter *dataAdapter)
         {
             this->_dataAdapter = dataAdapter;
+
+            // Replies are rendered once per data snapshot instead of once per request
+            if (dataAdapter != nullptr)
+                dataAdapter->addOnDataUpdatedCallback([this]() { this->rebuildReplyCache(); });
+
+            rebuildReplyCache();
         }
 
-        bool BMSLibProtocolUARTHandler::readLatestIncoming8BytesFrame(uint8_t slaveId)
+        FrameParserResult BMSLibProtocolUARTHandler::readIncomingFrame()
         {
             /*
               Reading and replying to frames on time is critical due to the nature of the Lib protocol.
@@ -118,7 +315,7 @@ namespace sdragos
               request from the inverter that asks for the voltage that you haven't read yet.
 
               Due to the above it is of paramount importance that we read everything that is in the UART buffer
-              and only process when we get a full 8 bytes frame and there're no other incoming bytes to process.
+              and only process when we get a full frame and there're no other incoming bytes to process.
 
               The code will check again before sending a reply if anything is available in the buffer and
               skip the reply when that's the case.
@@ -126,587 +323,622 @@ namespace sdragos
                :O - let's not blow up the house
             */
             size_t iterationCount = 0;
-            while (this->available())
+            uint8_t chunk[RX_CHUNK_SIZE];
+            size_t chunkLength;
+            while ((chunkLength = this->read_available(chunk, RX_CHUNK_SIZE)) > 0)
             {
-                uint8_t byteRead = read();
-
-                // If buffer is full, look for a new SLAVE_ID that might be the start of a frame.
-                // This is practically a sliding window over incoming bytes.
-                if (_rxBufferIndex >= DEVICE_QUERY_FRAME_SIZE)
+                _lastByteReceivedAtUs = esp_timer_get_time();
+                if (_pendingRxIdleUs != 0 && iterationCount == 0 && chunkLength == _pendingRxIdleBytes)
                 {
-                    size_t i = 1;
-                    while (i < DEVICE_QUERY_FRAME_SIZE && _rxBuffer[i] != slaveId)
-                        ++i;
-
-                    if (i < DEVICE_QUERY_FRAME_SIZE) // SLAVE_ID found
-                    {
-                        size_t remainingBytes = DEVICE_QUERY_FRAME_SIZE - i;
-                        memmove(_rxBuffer, _rxBuffer + i, remainingBytes);
-                        _rxBufferIndex = remainingBytes;
-                    }
-                    else // SLAVE_ID not found
-                    {
-                        _rxBufferIndex = 0;
-                    }
+                    // Nothing arrived after the bytes of the receive timeout event, so they were already
+                    // followed by the idle time the UART waited for
+                    _lastByteReceivedAtUs -= _pendingRxIdleUs;
                 }
+                _pendingRxIdleUs = 0;
+                iterationCount += chunkLength;
 
-                iterationCount++;
+                for (size_t i = 0; i < chunkLength; i++)
+                {
+                    FrameParserResult result = _frameParser.feed(chunk[i]);
+                    if (result == FrameParserResult::Incomplete)
+                        continue;
 
-                // If we're at the start of the buffer, look for SLAVE_ID to start a frame
-                if (_rxBufferIndex == 0 && byteRead != slaveId){
-                    if (iterationCount > 15){
-                        // The iteration has been going on for too long without
-                        // a result, so we should break out of it and let other
-                        // processes do work too.
-                        break;
-                    }
-                    else{
+                    // Bytes after the end of the frame were already received, so the inverter did not wait
+                    // for our reply. Like with the inter-frame silence check, the frame is dropped and the
+                    // parser starts over with the bytes that follow it.
+                    if (i + 1 < chunkLength || this->available())
+                    {
+                        ESP_LOGW("BMSLibProtocolUARTHandler", "%s", "More bytes received right after a frame. Skipping frame.");
+                        _stats.interruptedFrames++;
+                        _predictor.breakSequence();
                         continue;
                     }
+
+                    return result;
                 }
 
-                // Add byte to the buffer
-                _rxBuffer[_rxBufferIndex++] = byteRead;
+                if (_frameParser.isIdle() && iterationCount > 15)
+                {
+                    // The iteration has been going on for too long without
+                    // a result, so we should break out of it and let other
+                    // processes do work too.
+                    break;
+                }
             }
 
-            return (_rxBufferIndex == DEVICE_QUERY_FRAME_SIZE);
+            return FrameParserResult::Incomplete;
         }
 
-        uint16_t BMSLibProtocolUARTHandler::calculateModbusCrc16(uint8_t *buffer, size_t len)
+        uint32_t BMSLibProtocolUARTHandler::bitsPerCharacter()
         {
-            uint16_t crc = 0xFFFF;
-            for (size_t i = 0; i < len; ++i)
-            {
-                crc ^= buffer[i];
-                for (int j = 0; j < 8; ++j)
-                {
-                    if (crc & 0x0001)
-                    {
-                        crc = (crc >> 1) ^ 0xA001;
-                    }
-                    else
-                    {
-                        crc >>= 1;
-                    }
-                }
-            }
-            return crc;
+            // start bit + data bits + optional parity bit + stop bits
+            uint32_t bits = 1 + this->parent_->get_data_bits() + this->parent_->get_stop_bits();
+            if (this->parent_->get_parity() != UART_CONFIG_PARITY_NONE)
+                bits++;
+            return bits;
         }
 
-        void BMSLibProtocolUARTHandler::checkAndProcessLatest8BytesFrame()
+        uint32_t BMSLibProtocolUARTHandler::calculateInterFrameSilenceUs()
         {
-            // This method assumes that we have an 8 bytes frame in the buffer
-            // and that it starts with the desired slave identifier.
-            uint16_t receivedCrc = (_rxBuffer[7] << 8) | _rxBuffer[6];
-            if (calculateModbusCrc16(_rxBuffer, 6) != receivedCrc)
-            {
-                ESP_LOGE("BMSLibProtocolUARTHandler", "%s", "Invalid CRC.");
-                sendInvalidCrcReply();
-                return;
+            uint32_t baudRate = this->parent_->get_baud_rate();
+            if (baudRate == 0 || baudRate > MODBUS_RTU_FIXED_INTER_FRAME_SILENCE_BAUD_RATE)
+                return MODBUS_RTU_FIXED_INTER_FRAME_SILENCE_US;
+
+            // 3.5 character times, rounded up
+            return (bitsPerCharacter() * 7 * 1000000UL + (2 * baudRate - 1)) / (2 * baudRate);
+        }
+
+        bool BMSLibProtocolUARTHandler::waitForInterFrameSilence()
+        {
+            // The timestamp is taken when the byte was read out of the UART driver, which is never earlier
+            // than when it arrived on the wire, so the measured silence is never longer than the real one.
+            // Bytes reported by the receive timeout event were already followed by the silence, see
+            // readIncomingFrame(), so with UART events this rarely waits at all.
+            constexpr uint32_t TICK_US = portTICK_PERIOD_MS * 1000UL;
+            int64_t elapsedUs;
+            while ((elapsedUs = esp_timer_get_time() - _lastByteReceivedAtUs) < _interFrameSilenceUs)
+            {
+                if (this->available())
+                    return false;
+
+                // Whole ticks are slept, which lets the lower priority tasks run. FreeRTOS can't sleep for
+                // less, the rest is waited out one character time at a time.
+                const uint32_t remainingUs = _interFrameSilenceUs - (uint32_t)elapsedUs;
+                if (remainingUs >= TICK_US)
+                    vTaskDelay(remainingUs / TICK_US);
+                else
+                    esp_rom_delay_us(_characterTimeUs != 0 ? std::min(remainingUs, _characterTimeUs) : remainingUs);
             }
 
-            if (_rxBuffer[1] == COMMAND_READ_DATA)
+            return !this->available();
+        }
+
+        void BMSLibProtocolUARTHandler::processFrame(const uint8_t *pData, size_t len)
+        {
+            // The parser only returns frames that start with our slave identifier, have a supported
+            // command, the length that command requires and a valid CRC.
+            _stats.framesReceived++;
+
+            if (pData[1] == COMMAND_READ_DATA)
             {
-                processReadDataFrame(_rxBuffer, DEVICE_QUERY_FRAME_SIZE);
+                processReadDataFrame(pData, len);
             }
-            else if (_rxBuffer[1] == COMMAND_WRITE_DATA)
+            else if (pData[1] == COMMAND_WRITE_DATA)
             {
-                processWriteDataFrame(_rxBuffer, DEVICE_QUERY_FRAME_SIZE);
+                processWriteDataFrame(pData, len);
             }
             else
             {
-                ESP_LOGE("BMSLibProtocolUARTHandler", "Unknown command %d", _rxBuffer[1]);
+                ESP_LOGE("BMSLibProtocolUARTHandler", "Unknown command %d", pData[1]);
             }
         }
 
-        void BMSLibProtocolUARTHandler::processWriteDataFrame(uint8_t *pData, size_t len)
+        void BMSLibProtocolUARTHandler::processWriteDataFrame(const uint8_t *pData, size_t len)
         {
-            // Verify the command length and CRC
-            if (len < 8)
+            const uint16_t dataAddress = (pData[2] << 8) | pData[3];
+            const uint16_t registerCount = (pData[4] << 8) | pData[5];
+            const uint8_t byteCount = pData[6];
+
+            if (registerCount == 0 || registerCount > MAX_WRITE_REGISTERS || byteCount != registerCount * 2)
             {
-                ESP_LOGE("BMSLibProtocolUARTHandler", "%s", "Invalid command length. Skipping frame.");
+                ESP_LOGE("BMSLibProtocolUARTHandler", "Invalid write of %d registers with %d bytes. Skipping frame.", registerCount, byteCount);
+                writeReplyIfIdle(WRITE_ILLEGAL_DATA_VALUE_REPLY.data(), WRITE_ILLEGAL_DATA_VALUE_REPLY.size());
                 return;
             }
-            uint16_t receivedCrc = (pData[len - 1] << 8) | pData[len - 2];
-            if (calculateModbusCrc16(pData, len - 2) != receivedCrc)
+
+            // Registers are written in order, a rejected one stops the write
+            for (uint16_t i = 0; i < registerCount; i++)
             {
-                ESP_LOGE("BMSLibProtocolUARTHandler", "%s", "Invalid CRC.");
-                sendInvalidCrcReply();
-                return;
+                const uint8_t *value = pData + BMSLibProtocolFrameParser::WRITE_FRAME_HEADER_SIZE + i * 2;
+                if (this->_dataAdapter == nullptr || !this->_dataAdapter->writeRegister(dataAddress + i, (value[0] << 8) | value[1]))
+                {
+                    ESP_LOGE("BMSLibProtocolUARTHandler", "Write to address 0x%04X rejected.", dataAddress + i);
+                    writeReplyIfIdle(WRITE_ILLEGAL_DATA_ADDRESS_REPLY.data(), WRITE_ILLEGAL_DATA_ADDRESS_REPLY.size());
+                    return;
+                }
             }
 
-            // todo: implement write data here
+            // The reply echoes the address and the register count
+            std::array<uint8_t, 8> reply;
+            memcpy(reply.data(), pData, 6);
+            uint16_t crc = ModbusCrc16::compute(reply.data(), 6);
+            reply[6] = (uint8_t)crc;        // LSB
+            reply[7] = (uint8_t)(crc >> 8); // MSB
+
+            writeReplyIfIdle(reply.data(), reply.size());
         }
 
-        void BMSLibProtocolUARTHandler::processReadDataFrame(uint8_t *pData, size_t len)
+        void BMSLibProtocolUARTHandler::processReadDataFrame(const uint8_t *pData, size_t len)
         {
             const uint16_t dataAddress = (pData[2] << 8) | pData[3];
 
-            // Unused. (Why does this value need to be in the frame when we know the value based on the dataAddress?)
-            uint16_t dataLength = (pData[4] << 8) | pData[5];
+            // Number of 16 bits registers to read. Requests for a single value carry the width of that value,
+            // anything longer is a block read of consecutive addresses that is answered with a single reply.
+            const uint16_t dataLength = (pData[4] << 8) | pData[5];
+            if (dataLength > MAX_READ_REGISTERS)
+            {
+                ESP_LOGE("BMSLibProtocolUARTHandler", "Too many registers requested: %d. Skipping frame.", dataLength);
+                return;
+            }
+
+            // All the values in a reply come from the same snapshot
+            uint32_t generation = _replyCacheGeneration.load(std::memory_order_acquire);
+            const ReadRequest request{dataAddress, dataLength};
+
+            bool sent;
+            if (_requestPredictionEnabled && _stagedReply.length != 0 && _stagedReply.request == request &&
+                _stagedReply.generation == generation && this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
+            {
+                // The staged reply comes from the active snapshot, so it is exactly what encoding it now would give
+                ESP_LOGD("BMSLibProtocolUARTHandler", "Replying with the staged reply for address 0x%04X", dataAddress);
+                sent = writeReplyIfIdle(_stagedReply.bytes.data(), _stagedReply.length);
+                if (sent)
+                {
+                    _stats.predictedReplies++;
+                    _stats.predictionSavedUs += _stagedReply.encodeUs;
+                    _stats.predictedReplyLatency.record(_lastReplyLatencyUs);
+                }
+            }
+            else
+            {
+                if (_requestPredictionEnabled && _stagedReply.length != 0 && !(_stagedReply.request == request))
+                    _stats.mispredictedRequests++;
+
+                std::array<uint8_t, MAX_BLOCK_REPLY_SIZE> reply;
+                const size_t replyLen = encodeFromActiveCache(dataAddress, dataLength, reply.data(), true, generation);
+                sent = replyLen != 0 && writeReplyIfIdle(reply.data(), replyLen);
+            }
+
+            if (_requestPredictionEnabled)
+                _predictor.observe(request);
+
+            if (sent)
+                _stats.replyLatencyPerAddress[_dispatchTable[dataAddress & 0x00FF].statsIndex].record(_lastReplyLatencyUs);
+        }
+
+        const BMSLibProtocolUARTHandler::EncodedReply *BMSLibProtocolUARTHandler::findCachedReply(const ReplyCache &cache, uint16_t dataAddress, bool report)
+        {
+            const uint16_t page = dataAddress >> 8;
+            const DispatchEntry &entry = _dispatchTable[dataAddress & 0x00FF];
 
-            auto pFuncNoParam = _mapDataAddressToReplyToRequestNoParamFunc.find(dataAddress);
-            if (pFuncNoParam != _mapDataAddressToReplyToRequestNoParamFunc.end())
+            size_t replySlot;
+            if (page == 0x00 && entry.noParamFunc != nullptr)
+            {
+                // dataAddress values that do not depend on the page
+                replySlot = entry.noParamReplySlot;
+            }
+            else if (page <= DISPATCH_TABLE_MAX_PAGE && entry.dataAddressFunc != nullptr)
             {
-                // Call the processing function for dataAddress values that do not require
-                // the address as parameter
-                BMSLibProtocolUARTHandler::pReplyToRequestNoParamFunc funcNoParam = pFuncNoParam->second;
-                (this->*(funcNoParam))();
+                // dataAddress values that are answered per page, the slots of a low byte are consecutive
+                replySlot = entry.dataAddressReplySlot + page;
             }
             else
             {
-                auto pFuncStartAddressParam = _mapDataAddressToReplyToRequestDataAddressFunc.find(dataAddress);
-                if (pFuncStartAddressParam != _mapDataAddressToReplyToRequestDataAddressFunc.end())
+                if (report)
                 {
-                    // Call the processing function for dataAddress values that needs the actual
-                    // dataAddress to be passed on as a parameter. Usually these commands are implemented
-                    // by a single function and the answer depends on the actual dataAddress supplied.
-                    BMSLibProtocolUARTHandler::pReplyToRequestDataAddressFunc funcStartAddressParam = pFuncStartAddressParam->second;
-                    (this->*(funcStartAddressParam))(dataAddress);
+                    ESP_LOGE("BMSLibProtocolUARTHandler", "Unsupported address received: 0x%04X. Skipping frame.", dataAddress);
+                    _stats.unsupportedAddresses++;
                 }
-                else
+                return nullptr;
+            }
+
+            if (entry.requiresData && (this->_dataAdapter == nullptr || !this->_dataAdapter->hasUpdatedData()))
+            {
+                if (report)
                 {
-                    ESP_LOGE("BMSLibProtocolUARTHandler", "%s", "Unsupported address received. Skipping frame.");
-                    return; // Do not send a reply for unsupported addresses
+                    ESP_LOGW("BMSLibProtocolUARTHandler", "No recent BMS data to reply for address 0x%04X.", dataAddress);
+                    _stats.staleDataNoReplies++;
                 }
+                return nullptr;
             }
+
+            const EncodedReply &reply = cache[replySlot];
+            return reply.length != 0 ? &reply : nullptr;
         }
 
-        void BMSLibProtocolUARTHandler::sendInvalidCrcReply()
+        size_t BMSLibProtocolUARTHandler::encodeReadReply(const ReplyCache &cache, uint16_t dataAddress, uint16_t dataLength, uint8_t *out, bool report)
         {
-            constexpr size_t replyLen = 5;
-            const auto reply = new uint8_t[replyLen];
-            reply[0] = SLAVE_ID;
-            reply[1] = COMMAND_READ_DATA + 128;
-            reply[2] = 0x03; // invalid CRC error code
-            uint16_t crc = calculateModbusCrc16(reply, replyLen - 2);
-            reply[3] = (uint8_t)crc;
-            reply[4] = (uint8_t)(crc >> 8);
+            const EncodedReply *reply = findCachedReply(cache, dataAddress, report);
+            if (reply == nullptr)
+                return 0; // Do not send a reply for unsupported addresses
+
+            if (dataLength > payloadRegisters(*reply))
+            {
+                if (report)
+                    ESP_LOGD("BMSLibProtocolUARTHandler", "Replying for %d registers from address 0x%04X", dataLength, dataAddress);
+                return encodeBlockReply(cache, dataAddress, dataLength, out, report);
+            }
 
-            if (!available())
-                write_array(reply, replyLen);
-            delete[] reply;
+            if (report)
+                ESP_LOGD("BMSLibProtocolUARTHandler", "Replying for address 0x%04X", dataAddress);
+            memcpy(out, reply->bytes, reply->length);
+            return reply->length;
         }
 
-        void BMSLibProtocolUARTHandler::send2BytesPayloadReply(uint8_t *twoBytes)
+        size_t BMSLibProtocolUARTHandler::encodeBlockReply(const ReplyCache &cache, uint16_t dataAddress, uint16_t dataLength, uint8_t *out, bool report)
         {
-            if (sizeof(twoBytes) != 4)
+            uint8_t *reply = out;
+            size_t replyLen = 4;
+
+            // Concatenate the payloads of consecutive addresses. A 4 bytes value takes 2 registers, so the
+            // address after it is 2 higher (0x0003 firmware version, 0x0005 hardware version).
+            uint16_t registers = 0;
+            uint16_t address = dataAddress;
+            while (registers < dataLength)
             {
-                ESP_LOGE("BMSLibProtocolUARTHandler", "Got unexpected payload size in send2BytesPayloadReply. Stopping. Size: %d", sizeof(twoBytes));
-                return;
-            }
+                const EncodedReply *item = findCachedReply(cache, address, report);
+                if (item == nullptr)
+                    return 0; // The whole block is skipped when any address in it can't be answered
+
+                const uint16_t itemRegisters = payloadRegisters(*item);
+                if (registers + itemRegisters > dataLength)
+                {
+                    if (report)
+                        ESP_LOGE("BMSLibProtocolUARTHandler", "Block read ends inside the value at 0x%04X. Skipping frame.", address);
+                    return 0;
+                }
 
-            constexpr size_t replyLen = 8;
-            const auto reply = new uint8_t[replyLen];
+                memcpy(reply + replyLen, item->bytes + 4, itemRegisters * 2);
+                replyLen += itemRegisters * 2;
+                registers += itemRegisters;
+                address += itemRegisters;
+            }
 
             reply[0] = SLAVE_ID;
             reply[1] = COMMAND_READ_DATA;
-            reply[2] = 0; // MSB data size
-            reply[3] = 1; // LSB data size
-
-            reply[4] = twoBytes[0]; // MSB data
-            reply[5] = twoBytes[1]; // LSB data
+            reply[2] = (uint8_t)(registers >> 8); // MSB data size
+            reply[3] = (uint8_t)registers;        // LSB data size
 
-            // Calculate and append the CRC
-            uint16_t crc = calculateModbusCrc16(reply, replyLen - 2);
-            reply[6] = (uint8_t)crc;        // LSB
-            reply[7] = (uint8_t)(crc >> 8); // MSB
+            uint16_t crc = ModbusCrc16::compute(reply, replyLen);
+            reply[replyLen++] = (uint8_t)crc;        // LSB
+            reply[replyLen++] = (uint8_t)(crc >> 8); // MSB
 
-            // Send the reply only when no new bytes were received, otherwise we're too late.
-            // If we continue, we might send a reply for a message unknown yet to this code.
-            if (!available())
-                write_array(reply, replyLen);
+            return replyLen;
+        }
 
-            delete[] reply;
-            delete[] twoBytes;
+        void BMSLibProtocolUARTHandler::sendInvalidCrcReply()
+        {
+            writeReplyIfIdle(INVALID_CRC_REPLY.data(), INVALID_CRC_REPLY.size());
         }
 
-        void BMSLibProtocolUARTHandler::send4BytesPayloadReply(uint8_t *fourBytes)
+        void BMSLibProtocolUARTHandler::stageNextReply()
         {
-            if (sizeof(fourBytes) != 4)
+            ReadRequest next;
+            if (!_predictor.predictNext(next))
             {
-                ESP_LOGE("BMSLibProtocolUARTHandler", "Got unexpected payload size in send4BytesPayloadReply. Stopping. Size: %d", sizeof(fourBytes));
+                _stagedReply.length = 0;
                 return;
             }
 
-            constexpr size_t replyLen = 10;
-            const auto reply = new uint8_t[replyLen];
+            const uint32_t generation = _replyCacheGeneration.load(std::memory_order_acquire);
+            if (_stagedReply.length != 0 && _stagedReply.request == next && _stagedReply.generation == generation)
+                return; // Already staged from the current snapshot
 
-            reply[0] = SLAVE_ID;
-            reply[1] = COMMAND_READ_DATA;
-            reply[2] = 0; // MSB data size
-            reply[3] = 2; // LSB data size
+            const int64_t startedAtUs = esp_timer_get_time();
+            _stagedReply.request = next;
+            _stagedReply.length = encodeFromActiveCache(next.dataAddress, next.dataLength, _stagedReply.bytes.data(), false,
+                                                        _stagedReply.generation);
+            _stagedReply.encodeUs = (uint32_t)(esp_timer_get_time() - startedAtUs);
+        }
 
-            reply[4] = fourBytes[0]; // MSB data
-            reply[5] = fourBytes[1];
-            reply[6] = fourBytes[2];
-            reply[7] = fourBytes[3]; // LSB data
+        size_t BMSLibProtocolUARTHandler::encodeFromActiveCache(uint16_t dataAddress, uint16_t dataLength, uint8_t *out, bool report, uint32_t &generation)
+        {
+            for (uint8_t attempt = 0; attempt < REPLY_CACHE_READ_ATTEMPTS; attempt++)
+            {
+                // The generation is loaded first, so it is never newer than the cache
+                generation = _replyCacheGeneration.load(std::memory_order_acquire);
+                const ReplyCache &cache = *_activeReplyCache.load(std::memory_order_acquire);
+                const size_t length = encodeReadReply(cache, dataAddress, dataLength, out, report && attempt == 0);
 
-            // Calculate and append the CRC
-            uint16_t crc = calculateModbusCrc16(reply, replyLen - 2);
-            reply[8] = (uint8_t)crc;        // LSB
-            reply[9] = (uint8_t)(crc >> 8); // MSB
+                // The cache that was read is only rewritten after another swap, which changes the generation
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_replyCacheGeneration.load(std::memory_order_relaxed) == generation)
+                    return length;
+            }
+
+            ESP_LOGW("BMSLibProtocolUARTHandler", "Reply cache rebuilt while reading it, no reply for address 0x%04X.", dataAddress);
+            return 0;
+        }
 
+        bool BMSLibProtocolUARTHandler::writeReplyIfIdle(const uint8_t *data, size_t len)
+        {
             // Send the reply only when no new bytes were received, otherwise we're too late.
             // If we continue, we might send a reply for a message unknown yet to this code.
-            if (!available())
-                write_array(reply, replyLen);
+            if (available())
+            {
+                _stats.suppressedReplies++;
+                return false;
+            }
 
-            delete[] reply;
-            delete[] fourBytes;
+            _lastReplyLatencyUs = (uint32_t)(esp_timer_get_time() - _lastByteReceivedAtUs);
+            write_array(data, len);
+            _stats.replyLatency.record(_lastReplyLatencyUs);
+            return true;
         }
 
-        void BMSLibProtocolUARTHandler::replyForProtocolType()
+        void BMSLibProtocolUARTHandler::rebuildReplyCache()
+        {
+            static_assert(countAddresses(buildDispatchTable(), false) == FIXED_ADDRESSES,
+                          "FIXED_ADDRESSES does not match the addresses in the dispatch table.");
+            static_assert(countAddresses(buildDispatchTable(), true) == PAGED_ADDRESSES,
+                          "PAGED_ADDRESSES does not match the addresses in the dispatch table.");
+
+            // Render into the cache that is not in use and publish it with a single pointer store, so a reply
+            // is either completely from the previous snapshot or completely from the new one.
+            ReplyCache *cache = _activeReplyCache.load(std::memory_order_relaxed) == &_replyCaches[0]
+                                    ? &_replyCaches[1]
+                                    : &_replyCaches[0];
+            // The writes below stay after the generation increment of the previous swap, which tells a reader
+            // of this cache to read again
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (size_t lowByte = 0; lowByte < DISPATCH_TABLE_SIZE; lowByte++)
+            {
+                const DispatchEntry &entry = _dispatchTable[lowByte];
+                const bool canRender = !entry.requiresData || this->_dataAdapter != nullptr;
+
+                if (entry.noParamFunc != nullptr)
+                {
+                    EncodedReply &reply = (*cache)[entry.noParamReplySlot];
+                    reply.length = 0;
+                    if (canRender)
+                        (this->*(entry.noParamFunc))(reply);
+                }
+
+                if (entry.dataAddressFunc != nullptr)
+                {
+                    for (uint16_t page = 0; page <= DISPATCH_TABLE_MAX_PAGE; page++)
+                    {
+                        EncodedReply &reply = (*cache)[entry.dataAddressReplySlot + page];
+                        reply.length = 0;
+                        if (canRender)
+                            (this->*(entry.dataAddressFunc))(reply, (page << 8) | lowByte);
+                    }
+                }
+            }
+
+            _activeReplyCache.store(cache, std::memory_order_release);
+            _replyCacheGeneration.fetch_add(1, std::memory_order_release);
+            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "Reply cache rebuilt.");
+        }
+
+        void BMSLibProtocolUARTHandler::encode2BytesPayloadReply(EncodedReply &reply, uint16_t value)
+        {
+            reply.bytes[0] = SLAVE_ID;
+            reply.bytes[1] = COMMAND_READ_DATA;
+            reply.bytes[2] = 0; // MSB data size
+            reply.bytes[3] = 1; // LSB data size
+
+            reply.bytes[4] = (uint8_t)(value >> 8); // MSB data
+            reply.bytes[5] = (uint8_t)value;        // LSB data
+
+            // Continue the pre-checksummed header CRC with the payload and append it
+            uint16_t crc = ModbusCrc16::update(TWO_BYTES_PAYLOAD_REPLY_HEADER_CRC, reply.bytes + 4, 2);
+            reply.bytes[6] = (uint8_t)crc;        // LSB
+            reply.bytes[7] = (uint8_t)(crc >> 8); // MSB
+
+            reply.length = 8;
+        }
+
+        void BMSLibProtocolUARTHandler::encode4BytesPayloadReply(EncodedReply &reply, uint32_t value)
+        {
+            reply.bytes[0] = SLAVE_ID;
+            reply.bytes[1] = COMMAND_READ_DATA;
+            reply.bytes[2] = 0; // MSB data size
+            reply.bytes[3] = 2; // LSB data size
+
+            reply.bytes[4] = (uint8_t)(value >> 24); // MSB data
+            reply.bytes[5] = (uint8_t)(value >> 16);
+            reply.bytes[6] = (uint8_t)(value >> 8);
+            reply.bytes[7] = (uint8_t)value;         // LSB data
+
+            // Continue the pre-checksummed header CRC with the payload and append it
+            uint16_t crc = ModbusCrc16::update(FOUR_BYTES_PAYLOAD_REPLY_HEADER_CRC, reply.bytes + 4, 4);
+            reply.bytes[8] = (uint8_t)crc;        // LSB
+            reply.bytes[9] = (uint8_t)(crc >> 8); // MSB
+
+            reply.length = 10;
+        }
+
+        void BMSLibProtocolUARTHandler::replyForProtocolType(EncodedReply &reply)
         { // 0x0001, expected 2 bytes reply
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForProtocolType");
-            auto reply = new uint8_t[2];
-            reply[0] = 0x00;
-            reply[1] = 0x00;
-            send2BytesPayloadReply(reply);
+            encode2BytesPayloadReply(reply, 0x0000);
         }
 
-        void BMSLibProtocolUARTHandler::replyForProtocolVersion()
+        void BMSLibProtocolUARTHandler::replyForProtocolVersion(EncodedReply &reply)
         { // 0x0002, expected 2 bytes reply
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForProtocolVersion");
-            auto reply = new uint8_t[2];
-            reply[0] = 0x00;
-            reply[1] = 0x00;
-            send2BytesPayloadReply(reply);
+            encode2BytesPayloadReply(reply, 0x0000);
         }
 
-        void BMSLibProtocolUARTHandler::replyForBMSFirmwareVersion()
+        void BMSLibProtocolUARTHandler::replyForBMSFirmwareVersion(EncodedReply &reply)
         { // 0x0003, expected 4 bytes reply
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForBMSFirmwareVersion");
-
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getBMSFirmwareVersion();
-                send4BytesPayloadReply(result);
-            }
+            encode4BytesPayloadReply(reply, this->_dataAdapter->getBMSFirmwareVersion());
         }
 
-        void BMSLibProtocolUARTHandler::replyForBMSHardwareVersion()
+        void BMSLibProtocolUARTHandler::replyForBMSHardwareVersion(EncodedReply &reply)
         { // 0x0004, expected 4 bytes reply
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForBMSHardwareVersion");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getBMSHardwareVersion();
-                send4BytesPayloadReply(result);
-            }
+            encode4BytesPayloadReply(reply, this->_dataAdapter->getBMSHardwareVersion());
         }
 
-        void BMSLibProtocolUARTHandler::replyForNumberOfCellsRequest()
+        void BMSLibProtocolUARTHandler::replyForNumberOfCellsRequest(EncodedReply &reply)
         { // 0x0010, expected 2 bytes reply (integer, count of cells)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForNumberOfCellsRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getNumberOfCells();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getNumberOfCells());
         }
 
-        void BMSLibProtocolUARTHandler::replyForCellVoltageRequest(uint16_t dataAddress)
+        void BMSLibProtocolUARTHandler::replyForCellVoltageRequest(EncodedReply &reply, uint16_t dataAddress)
         { // 0x0011 - 0x0024, expected 2 bytes reply (integer, count of 0.1V)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForCellVoltageRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                uint16_t cellLowOrder = (dataAddress & 0x00FF) - 0x0010;
-                uint16_t cellHighOrder = (dataAddress >> 8) & 0x00FF;
-                uint16_t cellNumber = (cellHighOrder * 20) + cellLowOrder;
+            uint16_t cellLowOrder = (dataAddress & 0x00FF) - 0x0010;
+            uint16_t cellHighOrder = (dataAddress >> 8) & 0x00FF;
+            uint16_t cellNumber = (cellHighOrder * 20) + cellLowOrder;
 
-                ESP_LOGD("BMSLibProtocolUARTHandler", "replyForCellVoltageRequest for cell: %d", cellNumber);
-
-                auto result = this->_dataAdapter->getCellVoltageOrNull(cellNumber);
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getCellVoltageOrNull(cellNumber));
         }
 
-        void BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensors()
+        void BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensors(EncodedReply &reply)
         { // 0x0025, expected 2 bytes reply (integer, count of sensors)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForNumberOfTemperatureSensors");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getNumberOfTemperatureSensors();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getNumberOfTemperatureSensors());
         }
 
-        void BMSLibProtocolUARTHandler::replyForTemperatureRequest(uint16_t dataAddress)
+        void BMSLibProtocolUARTHandler::replyForTemperatureRequest(EncodedReply &reply, uint16_t dataAddress)
         { // 0x0026 - 0x002F -- expected 2 bytes reply (number of 0.1K)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForTemperatureRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                uint16_t tempSensorLowOrder = (dataAddress & 0x00FF) - 0x0025;
-                uint16_t tempSensorHighOrder = (dataAddress >> 8) & 0x00FF;
-                uint16_t sensorNumber = (tempSensorHighOrder * 10) + tempSensorLowOrder;
-
-                ESP_LOGD("BMSLibProtocolUARTHandler", "replyForTemperatureRequest for sensor: %d", sensorNumber);
+            uint16_t tempSensorLowOrder = (dataAddress & 0x00FF) - 0x0025;
+            uint16_t tempSensorHighOrder = (dataAddress >> 8) & 0x00FF;
+            uint16_t sensorNumber = (tempSensorHighOrder * 10) + tempSensorLowOrder;
 
-                auto result = this->_dataAdapter->getTemperatureOfSensorOrNull(sensorNumber);
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getTemperatureOfSensorOrNull(sensorNumber));
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleChargeCurrentRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleChargeCurrentRequest(EncodedReply &reply)
         { // 0x0030 -- expected 2 bytes reply (number of 0.1A)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleChargeCurrentRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleChargeCurrent();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleChargeCurrent());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentRequest(EncodedReply &reply)
         { // 0x0031 -- expected 2 bytes reply (number of 0.1A)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleDischargeCurrentRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleDischargeCurrent();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleDischargeCurrent());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleVoltageRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleVoltageRequest(EncodedReply &reply)
         { // 0x0032 -- expected 2 bytes reply (number of 0.1V)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleVoltageRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleVoltage();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleVoltage());
         }
 
-        void BMSLibProtocolUARTHandler::replyForStateOfChargeRequest()
+        void BMSLibProtocolUARTHandler::replyForStateOfChargeRequest(EncodedReply &reply)
         { // 0x0033 required -- expected 2 bytes reply (percentage)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForStateOfChargeRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getStateOfCharge();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getStateOfCharge());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleTotalCapacityRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleTotalCapacityRequest(EncodedReply &reply)
         { // 0x0034 -- expected 4 bytes reply (number of mAh)
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleTotalCapacityRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleTotalCapacity();
-                send4BytesPayloadReply(result);
-            }
+            encode4BytesPayloadReply(reply, this->_dataAdapter->getModuleTotalCapacity());
         }
 
-        void BMSLibProtocolUARTHandler::replyForNumberOfCellsWarningInfoRequest()
+        void BMSLibProtocolUARTHandler::replyForNumberOfCellsWarningInfoRequest(EncodedReply &reply)
         { // 0x0040
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForNumberOfCellsWarningInfoRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getNumberOfCellsForWarningInfo();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getNumberOfCellsForWarningInfo());
         }
 
-        void BMSLibProtocolUARTHandler::replyForCellPairVoltageStateRequest(uint16_t dataAddress)
+        void BMSLibProtocolUARTHandler::replyForCellPairVoltageStateRequest(EncodedReply &reply, uint16_t dataAddress)
         { // 0x0041 - 0x004A
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForCellPairVoltageStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                uint16_t tempSensorLowOrder = ((dataAddress & 0x00FF) - 0x0040) * 2 - 1;
-                uint16_t tempSensorHighOrder = (dataAddress >> 8) & 0x00FF;
-                uint16_t oddCellNumber = (tempSensorHighOrder * 20) + tempSensorLowOrder;
+            uint16_t tempSensorLowOrder = ((dataAddress & 0x00FF) - 0x0040) * 2 - 1;
+            uint16_t tempSensorHighOrder = (dataAddress >> 8) & 0x00FF;
+            uint16_t oddCellNumber = (tempSensorHighOrder * 20) + tempSensorLowOrder;
 
-                ESP_LOGD("BMSLibProtocolUARTHandler", "replyForCellPairVoltageStateRequest for sensor: %d", oddCellNumber);
-
-                auto result = this->_dataAdapter->getCellPairVoltageState(oddCellNumber);
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getCellPairVoltageState(oddCellNumber));
         }
 
-        void BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensorsWarningInfoRequest()
+        void BMSLibProtocolUARTHandler::replyForNumberOfTemperatureSensorsWarningInfoRequest(EncodedReply &reply)
         { // 0x0050
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForNumberOfTemperatureSensorsWarningInfoRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getNumberOfTemperatureSensorsForWarningInfo();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getNumberOfTemperatureSensorsForWarningInfo());
         }
 
-        void BMSLibProtocolUARTHandler::replyForTemperatureSensorPairStateRequest(uint16_t dataAddress)
+        void BMSLibProtocolUARTHandler::replyForTemperatureSensorPairStateRequest(EncodedReply &reply, uint16_t dataAddress)
         { // 0x0051 - 0x0055
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForTemperatureSensorPairStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                uint16_t tempSensorLowOrder = ((dataAddress & 0x00FF) - 0x0050) * 2 - 1;
-                uint16_t tempSensorHighOrder = (dataAddress >> 8) & 0x00FF;
-                uint16_t oddSensorNumber = (tempSensorHighOrder * 10) + tempSensorLowOrder;
-
-                ESP_LOGD("BMSLibProtocolUARTHandler", "replyForTemperatureSensorPairStateRequest for sensor: %d", oddSensorNumber);
+            uint16_t tempSensorLowOrder = ((dataAddress & 0x00FF) - 0x0050) * 2 - 1;
+            uint16_t tempSensorHighOrder = (dataAddress >> 8) & 0x00FF;
+            uint16_t oddSensorNumber = (tempSensorHighOrder * 10) + tempSensorLowOrder;
 
-                auto result = this->_dataAdapter->getTemperatureSensorPairState(oddSensorNumber);
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getTemperatureSensorPairState(oddSensorNumber));
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleChargeVoltageStateRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleChargeVoltageStateRequest(EncodedReply &reply)
         { // 0x0060
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleChargeVoltageStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleChargeVoltageState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleChargeVoltageState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleDischargeVoltageStateRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleDischargeVoltageStateRequest(EncodedReply &reply)
         { // 0x0061
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleDischargeVoltageStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleDischargeVoltageState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleDischargeVoltageState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForCellChargeVoltageStateRequest()
+        void BMSLibProtocolUARTHandler::replyForCellChargeVoltageStateRequest(EncodedReply &reply)
         { // 0x0062
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForCellChargeVoltageStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getCellChargeVoltageState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getCellChargeVoltageState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForCellDischargeVoltageStateRequest()
+        void BMSLibProtocolUARTHandler::replyForCellDischargeVoltageStateRequest(EncodedReply &reply)
         { // 0x0063
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForCellDischargeVoltageStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getCellDischargeVoltageState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getCellDischargeVoltageState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleChargeCurrentStateRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleChargeCurrentStateRequest(EncodedReply &reply)
         { // 0x0064
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleChargeCurrentStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleChargeCurrentState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleChargeCurrentState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentStateRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleDischargeCurrentStateRequest(EncodedReply &reply)
         { // 0x0065
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleDischargeCurrentStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleDischargeCurrentState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleDischargeCurrentState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleChargeTemperatureStateRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleChargeTemperatureStateRequest(EncodedReply &reply)
         { // 0x0066
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleChargeTemperatureStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleChargeTemperatureState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleChargeTemperatureState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForModuleDischargeTemperatureStateRequest()
+        void BMSLibProtocolUARTHandler::replyForModuleDischargeTemperatureStateRequest(EncodedReply &reply)
         { // 0x0067
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForModuleDischargeTemperatureStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getModuleDischargeTemperatureState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getModuleDischargeTemperatureState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForCellChargeTemperatureStateRequest()
+        void BMSLibProtocolUARTHandler::replyForCellChargeTemperatureStateRequest(EncodedReply &reply)
         { // 0x0068
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForCellChargeTemperatureStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getCellChargeTemperatureState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getCellChargeTemperatureState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForCellDischargeTemperatureStateRequest()
+        void BMSLibProtocolUARTHandler::replyForCellDischargeTemperatureStateRequest(EncodedReply &reply)
         { // 0x0069
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForCellDischargeTemperatureStateRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getCellDischargeTemperatureState();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getCellDischargeTemperatureState());
         }
 
-        void BMSLibProtocolUARTHandler::replyForChargeVoltageLimitRequest()
+        void BMSLibProtocolUARTHandler::replyForChargeVoltageLimitRequest(EncodedReply &reply)
         { // 0x0070 required
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForChargeVoltageLimitRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getChargeVoltageLimit();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getChargeVoltageLimit());
         }
 
-        void BMSLibProtocolUARTHandler::replyForDischargeVoltageLimitRequest()
+        void BMSLibProtocolUARTHandler::replyForDischargeVoltageLimitRequest(EncodedReply &reply)
         { // 0x0071 required
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForDischargeVoltageLimitRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getDischargeVoltageLimit();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getDischargeVoltageLimit());
         }
 
-        void BMSLibProtocolUARTHandler::replyForChargeCurrentLimitRequest()
+        void BMSLibProtocolUARTHandler::replyForChargeCurrentLimitRequest(EncodedReply &reply)
         { // 0x0072 required
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForChargeCurrentLimitRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getChargeCurrentLimit();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getChargeCurrentLimit());
         }
 
-        void BMSLibProtocolUARTHandler::replyForDischargeCurrentLimitRequest()
+        void BMSLibProtocolUARTHandler::replyForDischargeCurrentLimitRequest(EncodedReply &reply)
         { // 0x0073 required
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForDischargeCurrentLimitRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getDischargeCurrentLimit();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getDischargeCurrentLimit());
         }
 
-        void BMSLibProtocolUARTHandler::replyForChargeDischargeStatusRequest()
+        void BMSLibProtocolUARTHandler::replyForChargeDischargeStatusRequest(EncodedReply &reply)
         { // 0x0074 required
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForChargeDischargeStatusRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getChargeDischargeStatus();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getChargeDischargeStatus());
         }
 
-        void BMSLibProtocolUARTHandler::replyForRuntimeToEmptyRequest()
+        void BMSLibProtocolUARTHandler::replyForRuntimeToEmptyRequest(EncodedReply &reply)
         { // 0x0075
-            ESP_LOGD("BMSLibProtocolUARTHandler", "%s", "replyForRuntimeToEmptyRequest");
-            if (this->_dataAdapter != nullptr && this->_dataAdapter->hasUpdatedData())
-            {
-                auto result = this->_dataAdapter->getRuntimeToEmptySeconds();
-                send2BytesPayloadReply(result);
-            }
+            encode2BytesPayloadReply(reply, this->_dataAdapter->getRuntimeToEmptySeconds());
         }
     } // namespace mppsolar
 } // namespace sdragos
\ No newline at end of file
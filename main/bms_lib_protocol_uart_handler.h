@@ -1,11 +1,21 @@
 #pragma once
 
 #include "bms_lib_protocol_data_adapter.h"
-#include <map>
+#include "bms_lib_protocol_frame_parser.h"
+#include "bms_lib_protocol_request_predictor.h"
+#include "latency_histogram.h"
+#include "modbus_crc16.h"
+#include <array>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esphome/components/uart/uart_component_esp_idf.h"
 #include "esphome/components/uart/uart.h"
 
-#define DEVICE_QUERY_FRAME_SIZE 8
+// Modbus RTU fixes the inter-frame silence to 1750us for baud rates above 19200.
+#define MODBUS_RTU_FIXED_INTER_FRAME_SILENCE_US 1750
+#define MODBUS_RTU_FIXED_INTER_FRAME_SILENCE_BAUD_RATE 19200
 
 using namespace esphome;
 using namespace uart;
@@ -14,88 +24,267 @@ namespace sdragos
 {
     namespace mppsolar
     {
+        // Decides when a frame that was read from the UART is complete and can be replied to.
+        enum class FrameCompletionMode
+        {
+            // Waits a fixed 100ms after the frame was assembled.
+            FixedDelay,
+            // Waits for the Modbus RTU inter-frame silence (3.5 character times at the configured baud rate).
+            InterFrameSilence,
+        };
 
         class BMSLibProtocolUARTHandler : public esphome::uart::UARTDevice, public Component{
         public:
+            // The largest reply for a single Lib protocol address: header, 4 bytes payload and CRC.
+            static constexpr size_t MAX_REPLY_SIZE = 10;
+            // Modbus limits a read to 125 registers, which keeps a block reply within 256 bytes.
+            static constexpr uint16_t MAX_READ_REGISTERS = 125;
+            static constexpr size_t MAX_BLOCK_REPLY_SIZE = 4 + 2 * MAX_READ_REGISTERS + 2;
+
+            // A complete wire reply, CRC included. A length of 0 means there is nothing to send.
+            struct EncodedReply
+            {
+                uint8_t length;
+                uint8_t bytes[MAX_REPLY_SIZE];
+            };
+
+            // Distinct low bytes of the supported addresses: 29 that are only answered on page 0x00 and 45 that
+            // are answered on each page.
+            static constexpr size_t FIXED_ADDRESSES = 29;
+            static constexpr size_t PAGED_ADDRESSES = 45;
+
+            struct Stats
+            {
+                // Frames with a valid CRC
+                uint32_t framesReceived = 0;
+                uint32_t crcFailures = 0;
+                // Frames followed by more bytes before the inter-frame silence, which are not replied to
+                uint32_t interruptedFrames = 0;
+                uint32_t unsupportedAddresses = 0;
+                // Receive FIFO or ring buffer overflows, after which the received bytes are dropped
+                uint32_t rxOverflows = 0;
+                // Breaks, framing and parity errors reported by the UART driver
+                uint32_t lineErrors = 0;
+                // Reads that were not answered because the data adapter had no recent data
+                uint32_t staleDataNoReplies = 0;
+                // Replies that were ready but not sent, because new bytes had arrived in the meantime
+                uint32_t suppressedReplies = 0;
+                // Read requests answered with the reply staged while the line was idle, and the ones that
+                // turned out to be a different request than the staged one
+                uint32_t predictedReplies = 0;
+                uint32_t mispredictedRequests = 0;
+                // Encoding time of the staged replies that were sent, which was spent before the request arrived
+                uint64_t predictionSavedUs = 0;
+
+                // From the last byte of a request to the moment the reply is handed to the UART driver
+                LatencyHistogram replyLatency;
+                // The same, only for the replies that were staged in advance
+                LatencyHistogram predictedReplyLatency;
+                // The same, per address low byte. Pages of the same address share a histogram.
+                std::array<LatencyHistogram, FIXED_ADDRESSES + PAGED_ADDRESSES> replyLatencyPerAddress;
+            };
+
             BMSLibProtocolUARTHandler(UARTComponent *parent);
             // This method is required because EspHome gets confused if I try to
             // pass it to the constructor alongside the UARTComponent*. It allows
             // for a delayed setup too, which is fine.
             void setDataAdapter(BMSLibProtocolDataAdapter *dataAdapter);
+            void setFrameCompletionMode(FrameCompletionMode frameCompletionMode) { _frameCompletionMode = frameCompletionMode; }
+            // Learns the inverter polling sequence and encodes the reply for the most likely next request
+            // while the line is idle.
+            void setRequestPredictionEnabled(bool enabled) { _requestPredictionEnabled = enabled; }
             void setup() override;
             void loop() override;
-            void dump_config() override { };
+            // Serves the inverter from the calling task, woken up by the events of the UART driver instead of
+            // periodic loop() calls. Never returns.
+            void runOnUartEvents(IDFUARTComponent *uart);
+            void dump_config() override;
+            // Snapshot of the statistics, consistent while the handler task updates them. Valid until the next call.
+            const Stats &getStats();
+            void dumpStats();
             float get_setup_priority() const override { return 0.0f; };
 
         private:
             // Hard-coded Slave ID. The implementation will need to be changed if you're planning to use
             // more than 1 BMS on the same bus.
-            const uint8_t SLAVE_ID = 0x01;
-            const uint8_t COMMAND_READ_DATA = 0x03;
-            const uint8_t COMMAND_WRITE_DATA = 0x10;
+            static constexpr uint8_t SLAVE_ID = 0x01;
+            static constexpr uint8_t COMMAND_READ_DATA = BMSLibProtocolFrameParser::COMMAND_READ_DATA;
+            static constexpr uint8_t COMMAND_WRITE_DATA = BMSLibProtocolFrameParser::COMMAND_WRITE_DATA;
+            static constexpr uint16_t MAX_WRITE_REGISTERS = BMSLibProtocolFrameParser::MAX_WRITE_BYTE_COUNT / 2;
+            // Bytes taken from the UART driver at once. A read request fits in a single chunk.
+            static constexpr size_t RX_CHUNK_SIZE = 32;
+            // Idle character times after which the UART driver reports received bytes. Longer than the 3.5
+            // characters of the inter-frame silence, so a frame reported this way has already been followed by it.
+            static constexpr uint8_t RX_TIMEOUT_CHARACTERS = 4;
+            // How long runOnUartEvents() waits for an event before doing the idle work of loop()
+            static constexpr TickType_t IDLE_WAIT_TICKS = pdMS_TO_TICKS(10);
 
-            // Take note that the implementation of this class will release memory for arrays
-            // retrieved by calling methods on the data adapter.
-            BMSLibProtocolDataAdapter *_dataAdapter = nullptr;
+            // Replies with a fixed header are pre-checksummed at compile time, only the payload is added at runtime.
+            static constexpr uint16_t TWO_BYTES_PAYLOAD_REPLY_HEADER_CRC =
+                ModbusCrc16::compute(std::array<uint8_t, 4>{SLAVE_ID, COMMAND_READ_DATA, 0, 1});
+            static constexpr uint16_t FOUR_BYTES_PAYLOAD_REPLY_HEADER_CRC =
+                ModbusCrc16::compute(std::array<uint8_t, 4>{SLAVE_ID, COMMAND_READ_DATA, 0, 2});
+            static constexpr std::array<uint8_t, 5> INVALID_CRC_REPLY =
+                ModbusCrc16::withCrc(std::array<uint8_t, 3>{SLAVE_ID, COMMAND_READ_DATA + 128, 0x03 /* invalid CRC error code */});
+            // Modbus exception replies for writes the data adapter can't accept
+            static constexpr std::array<uint8_t, 5> WRITE_ILLEGAL_DATA_ADDRESS_REPLY =
+                ModbusCrc16::withCrc(std::array<uint8_t, 3>{SLAVE_ID, COMMAND_WRITE_DATA + 128, 0x02 /* illegal data address */});
+            static constexpr std::array<uint8_t, 5> WRITE_ILLEGAL_DATA_VALUE_REPLY =
+                ModbusCrc16::withCrc(std::array<uint8_t, 3>{SLAVE_ID, COMMAND_WRITE_DATA + 128, 0x03 /* illegal data value */});
 
-            bool readLatestIncoming8BytesFrame(uint8_t slaveId);
-            void checkAndProcessLatest8BytesFrame();
-            void processReadDataFrame(uint8_t *data, size_t len);
-            void processWriteDataFrame(uint8_t *pData, size_t len);
+            // Provides the payload values of the replies, see BMSLibProtocolDataAdapter.
+            BMSLibProtocolDataAdapter *_dataAdapter = nullptr;
 
-            uint16_t calculateModbusCrc16(uint8_t *buffer, size_t len);
+            // The body of loop(), which publishes the statistics after it when they may have changed
+            void serviceFrame();
+            // Copies the statistics for getStats(), between frames
+            void publishStats();
+            FrameParserResult readIncomingFrame();
+            uint32_t bitsPerCharacter();
+            uint32_t calculateInterFrameSilenceUs();
+            bool waitForInterFrameSilence();
+            void processFrame(const uint8_t *pData, size_t len);
+            void processReadDataFrame(const uint8_t *pData, size_t len);
+            void processWriteDataFrame(const uint8_t *pData, size_t len);
 
             void sendInvalidCrcReply();
-            void send2BytesPayloadReply(uint8_t *twoBytes);
-            void send4BytesPayloadReply(uint8_t *fourBytes);
-
-            void replyForProtocolType();       // 0x0001
-            void replyForProtocolVersion();    // 0x0002
-            void replyForBMSFirmwareVersion(); // 0x0003
-            void replyForBMSHardwareVersion(); // 0x0004
-
-            void replyForNumberOfCellsRequest();                    // 0x0010
-            void replyForCellVoltageRequest(uint16_t dataAddress);  // 0x0N11 - 0x0N24
-            void replyForNumberOfTemperatureSensors();              // 0x0025
-            void replyForTemperatureRequest(uint16_t dataAddress);  // 0x0N26 - 0x0N2F
-            void replyForModuleChargeCurrentRequest();              // 0x0030
-            void replyForModuleDischargeCurrentRequest();           // 0x0031
-            void replyForModuleVoltageRequest();                    // 0x0032
-            void replyForStateOfChargeRequest();                    // 0x0033 required
-            void replyForModuleTotalCapacityRequest();              // 0x0034
-
-            void replyForNumberOfCellsWarningInfoRequest();                       // 0x0040
-            void replyForCellPairVoltageStateRequest(uint16_t dataAddress);       // 0x0N41 - 0x0N4A
-            void replyForNumberOfTemperatureSensorsWarningInfoRequest();          // 0x0050
-            void replyForTemperatureSensorPairStateRequest(uint16_t dataAddress); // 0x0N51 - 0x0N55
-            void replyForModuleChargeVoltageStateRequest();                       // 0x0060
-            void replyForModuleDischargeVoltageStateRequest();                    // 0x0061
-            void replyForCellChargeVoltageStateRequest();                         // 0x0062
-            void replyForCellDischargeVoltageStateRequest();                      // 0x0063
-            void replyForModuleChargeCurrentStateRequest();                       // 0x0064
-            void replyForModuleDischargeCurrentStateRequest();                    // 0x0065
-            void replyForModuleChargeTemperatureStateRequest();                   // 0x0066
-            void replyForModuleDischargeTemperatureStateRequest();                // 0x0067
-            void replyForCellChargeTemperatureStateRequest();                     // 0x0068
-            void replyForCellDischargeTemperatureStateRequest();                  // 0x0069
-
-            void replyForChargeVoltageLimitRequest();    // 0x0070 required
-            void replyForDischargeVoltageLimitRequest(); // 0x0071 required
-            void replyForChargeCurrentLimitRequest();    // 0x0072 required
-            void replyForDischargeCurrentLimitRequest(); // 0x0073 required
-            void replyForChargeDischargeStatusRequest(); // 0x0074 required
-
-            void replyForRuntimeToEmptyRequest(); // 0x0075
-
-            uint8_t _rxBuffer[DEVICE_QUERY_FRAME_SIZE]{};
-            size_t _rxBufferIndex = 0;
-            bool _frameStarted = false;
-
-            using pReplyToRequestNoParamFunc = void (BMSLibProtocolUARTHandler::*)();
-            using pReplyToRequestDataAddressFunc = void (BMSLibProtocolUARTHandler::*)(uint16_t);
-
-            std::map<uint16_t, pReplyToRequestNoParamFunc> _mapDataAddressToReplyToRequestNoParamFunc{};
-            std::map<uint16_t, pReplyToRequestDataAddressFunc> _mapDataAddressToReplyToRequestDataAddressFunc{};
+            // Writes the reply unless new bytes were received in the meantime. Returns true when it was written.
+            bool writeReplyIfIdle(const uint8_t *data, size_t len);
+            void stageNextReply();
+            // Number of 16 bits registers in the payload of an encoded reply
+            static uint16_t payloadRegisters(const EncodedReply &reply) { return (reply.length - 6) / 2; }
+            void rebuildReplyCache();
+            void encode2BytesPayloadReply(EncodedReply &reply, uint16_t value);
+            void encode4BytesPayloadReply(EncodedReply &reply, uint32_t value);
+
+            void replyForProtocolType(EncodedReply &reply);       // 0x0001
+            void replyForProtocolVersion(EncodedReply &reply);    // 0x0002
+            void replyForBMSFirmwareVersion(EncodedReply &reply); // 0x0003
+            void replyForBMSHardwareVersion(EncodedReply &reply); // 0x0004
+
+            void replyForNumberOfCellsRequest(EncodedReply &reply);                     // 0x0010
+            void replyForCellVoltageRequest(EncodedReply &reply, uint16_t dataAddress); // 0x0N11 - 0x0N24
+            void replyForNumberOfTemperatureSensors(EncodedReply &reply);               // 0x0025
+            void replyForTemperatureRequest(EncodedReply &reply, uint16_t dataAddress); // 0x0N26 - 0x0N2F
+            void replyForModuleChargeCurrentRequest(EncodedReply &reply);               // 0x0030
+            void replyForModuleDischargeCurrentRequest(EncodedReply &reply);            // 0x0031
+            void replyForModuleVoltageRequest(EncodedReply &reply);                     // 0x0032
+            void replyForStateOfChargeRequest(EncodedReply &reply);                     // 0x0033 required
+            void replyForModuleTotalCapacityRequest(EncodedReply &reply);               // 0x0034
+
+            void replyForNumberOfCellsWarningInfoRequest(EncodedReply &reply);                         // 0x0040
+            void replyForCellPairVoltageStateRequest(EncodedReply &reply, uint16_t dataAddress);       // 0x0N41 - 0x0N4A
+            void replyForNumberOfTemperatureSensorsWarningInfoRequest(EncodedReply &reply);            // 0x0050
+            void replyForTemperatureSensorPairStateRequest(EncodedReply &reply, uint16_t dataAddress); // 0x0N51 - 0x0N55
+            void replyForModuleChargeVoltageStateRequest(EncodedReply &reply);                         // 0x0060
+            void replyForModuleDischargeVoltageStateRequest(EncodedReply &reply);                      // 0x0061
+            void replyForCellChargeVoltageStateRequest(EncodedReply &reply);                           // 0x0062
+            void replyForCellDischargeVoltageStateRequest(EncodedReply &reply);                        // 0x0063
+            void replyForModuleChargeCurrentStateRequest(EncodedReply &reply);                         // 0x0064
+            void replyForModuleDischargeCurrentStateRequest(EncodedReply &reply);                      // 0x0065
+            void replyForModuleChargeTemperatureStateRequest(EncodedReply &reply);                     // 0x0066
+            void replyForModuleDischargeTemperatureStateRequest(EncodedReply &reply);                  // 0x0067
+            void replyForCellChargeTemperatureStateRequest(EncodedReply &reply);                       // 0x0068
+            void replyForCellDischargeTemperatureStateRequest(EncodedReply &reply);                    // 0x0069
+
+            void replyForChargeVoltageLimitRequest(EncodedReply &reply);    // 0x0070 required
+            void replyForDischargeVoltageLimitRequest(EncodedReply &reply); // 0x0071 required
+            void replyForChargeCurrentLimitRequest(EncodedReply &reply);    // 0x0072 required
+            void replyForDischargeCurrentLimitRequest(EncodedReply &reply); // 0x0073 required
+            void replyForChargeDischargeStatusRequest(EncodedReply &reply); // 0x0074 required
+
+            void replyForRuntimeToEmptyRequest(EncodedReply &reply); // 0x0075
+
+            BMSLibProtocolFrameParser _frameParser{SLAVE_ID};
+
+            FrameCompletionMode _frameCompletionMode = FrameCompletionMode::FixedDelay;
+            uint32_t _interFrameSilenceUs = MODBUS_RTU_FIXED_INTER_FRAME_SILENCE_US;
+            // The shortest time in which another byte can arrive, the step the silence is checked in
+            uint32_t _characterTimeUs = 0;
+            int64_t _lastByteReceivedAtUs = 0;
+            // Set from a data event raised by the receive timeout: when exactly the bytes of that event are
+            // read, the line has already been idle for this long after the last of them.
+            uint32_t _pendingRxIdleUs = 0;
+            size_t _pendingRxIdleBytes = 0;
+
+            // Only used by the handler task, which copies it to _publishedStats between frames. _statsLock is
+            // only held for the copies, from and to _statsSnapshot in getStats().
+            Stats _stats;
+            Stats _publishedStats;
+            Stats _statsSnapshot;
+            SemaphoreHandle_t _statsLock;
+            uint32_t _lastReplyLatencyUs = 0;
+
+            using pReplyToRequestNoParamFunc = void (BMSLibProtocolUARTHandler::*)(EncodedReply &);
+            using pReplyToRequestDataAddressFunc = void (BMSLibProtocolUARTHandler::*)(EncodedReply &, uint16_t);
+
+            // The dispatch table is indexed by the low byte of the data address. Functions that take the
+            // data address as parameter serve every page (high byte 0x00 - 0x0F), the ones without
+            // parameter only serve page 0x00.
+            struct DispatchEntry
+            {
+                pReplyToRequestNoParamFunc noParamFunc;
+                pReplyToRequestDataAddressFunc dataAddressFunc;
+                // False when the reply does not depend on BMS data, so it can be sent before the first snapshot.
+                bool requiresData;
+                // Index of the pre-encoded reply in the reply cache. Paged addresses use one slot per page,
+                // starting at dataAddressReplySlot.
+                uint16_t noParamReplySlot;
+                uint16_t dataAddressReplySlot;
+                // Index in Stats::replyLatencyPerAddress
+                uint8_t statsIndex;
+            };
+
+            static constexpr size_t DISPATCH_TABLE_SIZE = 256;
+            static constexpr uint16_t DISPATCH_TABLE_MAX_PAGE = 0x0F;
+            using DispatchTable = std::array<DispatchEntry, DISPATCH_TABLE_SIZE>;
+
+            static constexpr DispatchTable buildDispatchTable();
+
+            static constexpr size_t REPLY_CACHE_SIZE = FIXED_ADDRESSES + PAGED_ADDRESSES * (DISPATCH_TABLE_MAX_PAGE + 1);
+            using ReplyCache = std::array<EncodedReply, REPLY_CACHE_SIZE>;
+
+            // Counts the low bytes answered only on page 0x00, or on every page when paged is true.
+            static constexpr size_t countAddresses(const DispatchTable &table, bool paged);
+
+            // Returns nullptr when the address is not supported or there is no data to answer it with. Only
+            // requests from the inverter are reported in the logs and the stats, staging is silent.
+            const EncodedReply *findCachedReply(const ReplyCache &cache, uint16_t dataAddress, bool report);
+            // Writes the wire reply to a read request into out, which holds MAX_BLOCK_REPLY_SIZE bytes.
+            // Returns its length, or 0 when the request can't be answered.
+            size_t encodeReadReply(const ReplyCache &cache, uint16_t dataAddress, uint16_t dataLength, uint8_t *out, bool report);
+            size_t encodeBlockReply(const ReplyCache &cache, uint16_t dataAddress, uint16_t dataLength, uint8_t *out, bool report);
+            // encodeReadReply() from the active cache, again when a rebuild may have rewritten it in the meantime.
+            // Sets generation to that of the snapshot the reply comes from. Returns 0 when no attempt was left
+            // undisturbed.
+            size_t encodeFromActiveCache(uint16_t dataAddress, uint16_t dataLength, uint8_t *out, bool report, uint32_t &generation);
+            static constexpr uint8_t REPLY_CACHE_READ_ATTEMPTS = 3;
+
+            static const DispatchTable _dispatchTable;
+
+            // Every supported reply is rendered after each data snapshot into the cache that is not active,
+            // then the active pointer is swapped. Rebuilds run in the task that polls the BMS. Two of them while
+            // the inverter task reads a cache would rewrite it, readers check the generation afterwards and
+            // read again, see encodeFromActiveCache().
+            std::array<ReplyCache, 2> _replyCaches{};
+            std::atomic<const ReplyCache *> _activeReplyCache{&_replyCaches[0]};
+            // Incremented after each swap. The caches alternate, so the pointer alone can't tell two snapshots apart.
+            std::atomic<uint32_t> _replyCacheGeneration{0};
+
+            // The reply to the request the predictor expects next, encoded from the snapshot of the given
+            // generation. A reply staged from an older snapshot is outdated and encoded again.
+            struct StagedReply
+            {
+                ReadRequest request;
+                uint32_t generation;
+                uint32_t encodeUs;
+                size_t length;
+                std::array<uint8_t, MAX_BLOCK_REPLY_SIZE> bytes;
+            };
+
+            bool _requestPredictionEnabled = false;
+            BMSLibProtocolRequestPredictor _predictor;
+            StagedReply _stagedReply{};
         }; // class BMSLibProtocolUARTHandler
 
     } // namespace mppsolar
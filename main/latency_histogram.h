@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <array>
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        /// @brief Fixed memory histogram of durations in microseconds.
+        ///        Bucket 0 counts durations below 128us, every following bucket doubles the limit and the last one
+        ///        counts everything from 131ms up.
+        class LatencyHistogram
+        {
+        public:
+            static constexpr size_t BUCKETS = 12;
+            static constexpr uint32_t FIRST_BUCKET_LIMIT_US = 128;
+            static constexpr uint8_t FIRST_BUCKET_LIMIT_BITS = 7;
+
+            void record(uint32_t durationUs)
+            {
+                size_t bucket = 0;
+                if (durationUs >= FIRST_BUCKET_LIMIT_US)
+                {
+                    // Index of the highest set bit, 7 for 128us - 255us
+                    size_t highestBit = 31 - __builtin_clz(durationUs);
+                    bucket = highestBit - FIRST_BUCKET_LIMIT_BITS + 1;
+                    if (bucket >= BUCKETS)
+                        bucket = BUCKETS - 1;
+                }
+
+                _counts[bucket]++;
+                _count++;
+                if (durationUs > _maxUs)
+                    _maxUs = durationUs;
+            }
+
+            // Upper limit of the bucket that holds the given percentile, or the maximum when that is lower.
+            uint32_t percentileUs(uint8_t percentile) const
+            {
+                if (_count == 0)
+                    return 0;
+
+                const uint64_t target = ((uint64_t)_count * percentile + 99) / 100;
+                uint64_t cumulative = 0;
+                uint32_t limit = FIRST_BUCKET_LIMIT_US;
+                for (size_t bucket = 0; bucket < BUCKETS - 1; bucket++, limit <<= 1)
+                {
+                    cumulative += _counts[bucket];
+                    if (cumulative >= target)
+                        return limit < _maxUs ? limit : _maxUs;
+                }
+                return _maxUs;
+            }
+
+            uint32_t count() const { return _count; }
+            uint32_t maxUs() const { return _maxUs; }
+
+        private:
+            std::array<uint32_t, BUCKETS> _counts{};
+            uint32_t _count = 0;
+            uint32_t _maxUs = 0;
+        }; // class LatencyHistogram
+    } // namespace mppsolar
+} // namespace sdragos
@@ -19,6 +19,8 @@
 #include "bms_lib_protocol_uart_handler.h"
 #include "bms_lib_protocol_data_adapter.h"
 #include "bms_lib_protocol_mock_data_adapter.h"
+#include "virtual_uart_component.h"
+#include "mpp_inverter_simulator.h"
 
 #define TAG "Main"
 
@@ -36,10 +38,28 @@
 
 #define BMS_LIB_BUF_SIZE (256)
 #define JK_BUF_SIZE (384)
+// Writes are copied into the TX buffers and sent by the driver in the background, so neither side
+// waits for its frames to be clocked out. Both have to be larger than the 128 byte hardware FIFO.
+#define BMS_LIB_TX_BUF_SIZE (512)
+#define JK_TX_BUF_SIZE (256)
 
-// Read packet timeout
+// The inverter side runs in its own task, above the main task that polls the JK BMS. The stack keeps the size
+// the handler had before it got its own task, the unused part is logged with the statistics to size it from.
 #define BMS_LIB_TASK_STACK_SIZE (32768)
 #define BMS_LIB_TASK_PRIO (10)
+// Away from the main task and the JK BMS polling where there is a second core
+#ifdef CONFIG_FREERTOS_UNICORE
+#define BMS_LIB_TASK_CORE (0)
+#else
+#define BMS_LIB_TASK_CORE (1)
+#endif
+#define SIMULATOR_TASK_STACK_SIZE (4096)
+#define SIMULATOR_TASK_PRIO (5)
+#define JK_BMS_MIN_UPDATE_INTERVAL_MS (CONFIG_JK_BMS_MIN_UPDATE_INTERVAL_MS)
+#define JK_BMS_MAX_UPDATE_INTERVAL_MS (CONFIG_JK_BMS_MAX_UPDATE_INTERVAL_MS)
+#define JK_BMS_FULL_UPDATE_INTERVAL_MS (CONFIG_JK_BMS_FULL_UPDATE_INTERVAL_MS)
+#define JK_BMS_UPLOAD_TIMEOUT_MS (CONFIG_JK_BMS_UPLOAD_TIMEOUT_MS)
+#define JK_BMS_TERMINAL_NUMBER (CONFIG_JK_BMS_TERMINAL_NUMBER)
 #define BMS_LIB_IDF_UART_PORT (CONFIG_BMS_LIB_UART_PORT_NUM)
 #define JK_IDF_UART_PORT (CONFIG_JK_UART_PORT_NUM)
 
@@ -52,6 +72,23 @@ using namespace sdragos::mppsolar;
 static esphome::jk_modbus::JkModbus *jkModbus_ = nullptr;
 static esphome::jk_bms::JkBms *jkBms_ = nullptr;
 static BMSLibProtocolUARTHandler *bmsLibProtocolUARTHandler_ = nullptr;
+static IDFUARTComponent *idfUartForLibProtocol_ = nullptr;
+static TaskHandle_t bmsLibProtocolTask_ = nullptr;
+#ifdef CONFIG_BMS_LIB_INVERTER_SIMULATOR
+static VirtualUARTComponent *virtualUartForLibProtocol_ = nullptr;
+static VirtualUARTComponent *virtualUartForInverter_ = nullptr;
+static MPPInverterSimulator *inverterSimulator_ = nullptr;
+
+static VirtualUARTComponent *newVirtualUart()
+{
+  VirtualUARTComponent *uart = new VirtualUARTComponent();
+  uart->set_baud_rate(CONFIG_BMS_LIB_UART_BAUD_RATE);
+  uart->set_data_bits(8);
+  uart->set_stop_bits(1);
+  uart->set_parity(UARTParityOptions::UART_CONFIG_PARITY_NONE);
+  return uart;
+}
+#endif
 
 namespace esphome
 {
@@ -64,13 +101,14 @@ namespace esphome
     idf_uart_for_lib_protocol->set_stop_bits(1);
     idf_uart_for_lib_protocol->set_parity(UARTParityOptions::UART_CONFIG_PARITY_NONE);
     idf_uart_for_lib_protocol->set_rx_buffer_size(BMS_LIB_BUF_SIZE);
-    idf_uart_for_lib_protocol->set_tx_buffer_size(0);
+    idf_uart_for_lib_protocol->set_tx_buffer_size(BMS_LIB_TX_BUF_SIZE);
     idf_uart_for_lib_protocol->set_event_queue_size(20);
     idf_uart_for_lib_protocol->set_tx_pin(new InternalGPIOPin(17, false));
     idf_uart_for_lib_protocol->set_rx_pin(new InternalGPIOPin(16, false));
     idf_uart_for_lib_protocol->set_uart_number(BMS_LIB_IDF_UART_PORT);
 
     idf_uart_for_lib_protocol->setup();
+    idfUartForLibProtocol_ = idf_uart_for_lib_protocol;
 
     IDFUARTComponent *idf_uart_for_jk_bms = new IDFUARTComponent();
     idf_uart_for_jk_bms->set_baud_rate(JK_UART_BAUD_RATE);
@@ -78,7 +116,7 @@ namespace esphome
     idf_uart_for_jk_bms->set_stop_bits(1);
     idf_uart_for_jk_bms->set_parity(UARTParityOptions::UART_CONFIG_PARITY_NONE);
     idf_uart_for_jk_bms->set_rx_buffer_size(JK_BUF_SIZE);
-    idf_uart_for_jk_bms->set_tx_buffer_size(0);
+    idf_uart_for_jk_bms->set_tx_buffer_size(JK_TX_BUF_SIZE);
     idf_uart_for_jk_bms->set_event_queue_size(20);
     idf_uart_for_jk_bms->set_tx_pin(new InternalGPIOPin(23, false));
     idf_uart_for_jk_bms->set_rx_pin(new InternalGPIOPin(22, false));
@@ -92,63 +130,130 @@ namespace esphome
     jkModbus_ = new esphome::jk_modbus::JkModbus();
     jkModbus_->set_uart_parent(idf_uart_for_jk_bms);
     jkModbus_->set_rx_timeout(100);
+    jkModbus_->set_upload_timeout(JK_BMS_UPLOAD_TIMEOUT_MS);
 
     ESP_LOGI(TAG, "JK Modbus setup done.\r\n");
 
     jkBms_ = new esphome::jk_bms::JkBms();
     jkBms_->set_parent(jkModbus_);
     jkBms_->set_address(0x4E);
+    // JkModbus polls its devices, each at its own interval. More packs are added like this one, each with a
+    // terminal number of its own.
+    jkBms_->set_terminal_number(JK_BMS_TERMINAL_NUMBER);
+    jkBms_->set_update_interval_bounds(JK_BMS_MIN_UPDATE_INTERVAL_MS, JK_BMS_MAX_UPDATE_INTERVAL_MS);
+    jkBms_->set_full_update_interval(JK_BMS_FULL_UPDATE_INTERVAL_MS);
     //jkBms_->set_enable_fake_traffic(true);
 
     ESP_LOGI(TAG, "JK BMS setup done.\r\n");
 
-    jkModbus_->register_device(jkBms_);
-
-    ESP_LOGI(TAG, "JK Modbus register device done.\r\n");
+    if (!jkModbus_->register_device(jkBms_))
+    {
+        ESP_LOGE(TAG, "JK BMS not registered, its terminal number collides with another pack.\r\n");
+    }
+    else
+    {
+        ESP_LOGI(TAG, "JK Modbus register device done.\r\n");
+    }
 
     jkModbus_->setup();
 
     ESP_LOGI(TAG, "JK Modbus setup done.\r\n");
 
+#ifdef CONFIG_BMS_LIB_INVERTER_SIMULATOR
+    // The handler talks to a simulated inverter and answers from mock data, see Kconfig.projbuild
+    virtualUartForLibProtocol_ = newVirtualUart();
+    virtualUartForInverter_ = newVirtualUart();
+    VirtualUARTComponent::connect(virtualUartForLibProtocol_, virtualUartForInverter_);
+
+    inverterSimulator_ = new MPPInverterSimulator(virtualUartForInverter_);
+    inverterSimulator_->setRequestGapMs(CONFIG_BMS_LIB_SIMULATOR_REQUEST_GAP_MS);
+    inverterSimulator_->setLateReplyUs(CONFIG_BMS_LIB_SIMULATOR_LATE_REPLY_US);
+
+    bmsLibProtocolUARTHandler_ = new BMSLibProtocolUARTHandler(virtualUartForLibProtocol_);
+    bmsLibProtocolUARTHandler_->setDataAdapter(new BMSLibProtocolMockDataAdapter());
+#else
     bmsLibProtocolUARTHandler_ = new BMSLibProtocolUARTHandler(idf_uart_for_lib_protocol);
 
     //auto mockDataAdapter = new BMSLibProtocolMockDataAdapter();
     bmsLibProtocolUARTHandler_->setDataAdapter(jkBms_);
+#endif
+#ifdef CONFIG_BMS_LIB_FRAME_COMPLETION_ON_INTER_FRAME_SILENCE
+    bmsLibProtocolUARTHandler_->setFrameCompletionMode(FrameCompletionMode::InterFrameSilence);
+#endif
+#ifdef CONFIG_BMS_LIB_PREDICT_NEXT_REQUEST
+    bmsLibProtocolUARTHandler_->setRequestPredictionEnabled(true);
+#endif
 
     bmsLibProtocolUARTHandler_->setup();
   }
 
+  static void bmsLibProtocolTask(void *arg)
+  {
+    // Replies to the inverter have to go out within a few milliseconds, so they don't wait for the JK BMS
+    // polling. The two sides only share the reply cache snapshot, see BMSLibProtocolUARTHandler.
+#ifdef CONFIG_BMS_LIB_INVERTER_SIMULATOR
+    // The virtual UART has no driver events, it wakes the handler up once written bytes have arrived
+    while (true)
+    {
+      virtualUartForLibProtocol_->waitForData(10 / portTICK_PERIOD_MS);
+      bmsLibProtocolUARTHandler_->loop();
+    }
+#else
+    bmsLibProtocolUARTHandler_->runOnUartEvents(idfUartForLibProtocol_);
+#endif
+    vTaskDelete(NULL);
+  }
+
+#ifdef CONFIG_BMS_LIB_INVERTER_SIMULATOR
+  static void inverterSimulatorTask(void *arg)
+  {
+    while (true)
+    {
+      virtualUartForInverter_->waitForData(1);
+      inverterSimulator_->loop();
+    }
+    vTaskDelete(NULL);
+  }
+#endif
+
   extern "C" void app_main(void)
   {
     setup();
 
+    xTaskCreatePinnedToCore(bmsLibProtocolTask, "bms_lib_protocol", BMS_LIB_TASK_STACK_SIZE, NULL, BMS_LIB_TASK_PRIO,
+                            &bmsLibProtocolTask_, BMS_LIB_TASK_CORE);
+#ifdef CONFIG_BMS_LIB_INVERTER_SIMULATOR
+    xTaskCreate(inverterSimulatorTask, "inverter_simulator", SIMULATOR_TASK_STACK_SIZE, NULL, SIMULATOR_TASK_PRIO, NULL);
+#endif
+
     ESP_LOGI(TAG, "UART start receive loop.\r\n");
 
     TickType_t tickCount = xTaskGetTickCount();
-    TickType_t previousUpdateWasAtTickCount = 0;
     TickType_t previousDumpConfigWasAtTickCount = 0;
 
-    TickType_t fiveSecondsTicks = 5000 / portTICK_PERIOD_MS;
     TickType_t thirtySecondsTicks = 30000 / portTICK_PERIOD_MS;
-    
-    jkBms_->update();
-    
-    
+
     while (true)
     {
       // In the loop methods the actual UART reads and writes happen.
       // These should return as quickly as possible to allow processing
-      // needed by other components.
-      bmsLibProtocolUARTHandler_->loop();
+      // needed by other components. The inverter side is served by its own task.
+      // Acts as a master, JkModbus polls the JK BMS for data so that it can
+      // be passed on the Lib protocol inverter on request.
       jkModbus_->loop();
 
       tickCount = xTaskGetTickCount();
-      if ((tickCount - previousUpdateWasAtTickCount) >= fiveSecondsTicks)
+      if ((tickCount - previousDumpConfigWasAtTickCount) >= thirtySecondsTicks)
       {
-        // Acts as a master, polls the JK BMS every 5 seconds for data so 
-        // that it can be passed on the Lib protocol inverter on request.
-        jkBms_->update();
-        previousUpdateWasAtTickCount = tickCount;
+        // Summary of the inverter side counters and reply latencies
+        bmsLibProtocolUARTHandler_->dump_config();
+        ESP_LOGI(TAG, "Lib protocol task stack: %u of %u bytes never used",
+                 (unsigned)uxTaskGetStackHighWaterMark(bmsLibProtocolTask_), (unsigned)BMS_LIB_TASK_STACK_SIZE);
+        jkModbus_->dump_config();
+#ifdef CONFIG_BMS_LIB_INVERTER_SIMULATOR
+        inverterSimulator_->dump_config();
+#endif
+        previousDumpConfigWasAtTickCount = tickCount;
       }
 
       vTaskDelay(10 / portTICK_PERIOD_MS);
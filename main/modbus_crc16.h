@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <array>
+#include "sdkconfig.h"
+
+// Number of 256 entries lookup tables used by ModbusCrc16::update. 1 is the classic table driven CRC,
+// 4 and 8 process that many bytes per step (slice-by-N) at the cost of 512 bytes of flash per table.
+#if defined(CONFIG_BMS_LIB_CRC16_SLICE_BY_8)
+#define MODBUS_CRC16_SLICES 8
+#elif defined(CONFIG_BMS_LIB_CRC16_SLICE_BY_4)
+#define MODBUS_CRC16_SLICES 4
+#else
+#define MODBUS_CRC16_SLICES 1
+#endif
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        /// @brief Modbus RTU CRC16 (reflected polynomial 0xA001, initial value 0xFFFF).
+        ///        Everything is constexpr, so fixed frames or frame headers can be checksummed at compile time.
+        ///        Running a complete frame, CRC included, through update() gives 0 when the frame is valid.
+        class ModbusCrc16
+        {
+        public:
+            static constexpr uint16_t INITIAL_VALUE = 0xFFFF;
+            static constexpr uint16_t POLYNOMIAL = 0xA001;
+
+            using Table = std::array<uint16_t, 256>;
+
+            template <size_t Slices>
+            using Tables = std::array<Table, Slices>;
+
+            // Table k holds the CRC contribution of a byte followed by k zero bytes.
+            template <size_t Slices>
+            static constexpr Tables<Slices> buildTables()
+            {
+                Tables<Slices> tables{};
+                for (uint16_t i = 0; i < 256; i++)
+                {
+                    uint16_t crc = i;
+                    for (int j = 0; j < 8; j++)
+                        crc = (crc & 0x0001) ? ((crc >> 1) ^ POLYNOMIAL) : (crc >> 1);
+                    tables[0][i] = crc;
+                }
+                for (size_t k = 1; k < Slices; k++)
+                {
+                    for (uint16_t i = 0; i < 256; i++)
+                    {
+                        uint16_t previous = tables[k - 1][i];
+                        tables[k][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+                    }
+                }
+                return tables;
+            }
+
+            // The bit by bit reference implementation, 8 iterations per byte.
+            static constexpr uint16_t updateBitwise(uint16_t crc, const uint8_t *data, size_t len)
+            {
+                for (size_t i = 0; i < len; ++i)
+                {
+                    crc ^= data[i];
+                    for (int j = 0; j < 8; ++j)
+                        crc = (crc & 0x0001) ? ((crc >> 1) ^ POLYNOMIAL) : (crc >> 1);
+                }
+                return crc;
+            }
+
+            // Table driven for Slices == 1, slice-by-4 or slice-by-8 for Slices == 4 or 8.
+            template <size_t Slices>
+            static constexpr uint16_t updateSliced(uint16_t crc, const uint8_t *data, size_t len);
+
+            static constexpr uint16_t update(uint16_t crc, uint8_t byte);
+
+            static constexpr uint16_t update(uint16_t crc, const uint8_t *data, size_t len)
+            {
+                return updateSliced<MODBUS_CRC16_SLICES>(crc, data, len);
+            }
+
+            template <size_t N>
+            static constexpr uint16_t update(uint16_t crc, const std::array<uint8_t, N> &data)
+            {
+                return update(crc, data.data(), N);
+            }
+
+            static constexpr uint16_t compute(const uint8_t *data, size_t len) { return update(INITIAL_VALUE, data, len); }
+
+            template <size_t N>
+            static constexpr uint16_t compute(const std::array<uint8_t, N> &data) { return update(INITIAL_VALUE, data); }
+
+            // Returns the frame with its CRC appended, low byte first as Modbus RTU expects it.
+            template <size_t N>
+            static constexpr std::array<uint8_t, N + 2> withCrc(const std::array<uint8_t, N> &frame)
+            {
+                std::array<uint8_t, N + 2> result{};
+                for (size_t i = 0; i < N; i++)
+                    result[i] = frame[i];
+                uint16_t crc = compute(frame);
+                result[N] = (uint8_t)crc;
+                result[N + 1] = (uint8_t)(crc >> 8);
+                return result;
+            }
+        };
+
+        template <size_t Slices>
+        inline constexpr ModbusCrc16::Tables<Slices> MODBUS_CRC16_TABLES = ModbusCrc16::buildTables<Slices>();
+
+        template <size_t Slices>
+        constexpr uint16_t ModbusCrc16::updateSliced(uint16_t crc, const uint8_t *data, size_t len)
+        {
+            static_assert(Slices == 1 || Slices == 4 || Slices == 8, "Supported CRC16 slices are 1, 4 and 8.");
+            const Tables<Slices> &t = MODBUS_CRC16_TABLES<Slices>;
+
+            size_t i = 0;
+            if constexpr (Slices > 1)
+            {
+                for (; i + Slices <= len; i += Slices)
+                {
+                    // The 16 bits CRC register only overlaps the first two bytes of the block.
+                    uint16_t x = crc ^ (uint16_t)(data[i] | (data[i + 1] << 8));
+                    uint16_t next = t[Slices - 1][x & 0xFF] ^ t[Slices - 2][x >> 8];
+                    for (size_t k = 2; k < Slices; k++)
+                        next ^= t[Slices - 1 - k][data[i + k]];
+                    crc = next;
+                }
+            }
+
+            for (; i < len; i++)
+                crc = (crc >> 8) ^ t[0][(crc ^ data[i]) & 0xFF];
+
+            return crc;
+        }
+
+        constexpr uint16_t ModbusCrc16::update(uint16_t crc, uint8_t byte)
+        {
+            return (crc >> 8) ^ MODBUS_CRC16_TABLES<MODBUS_CRC16_SLICES>[0][(crc ^ byte) & 0xFF];
+        }
+    } // namespace mppsolar
+} // namespace sdragos
@@ -0,0 +1,139 @@
+#include "mpp_inverter_simulator.h"
+#include "modbus_crc16.h"
+#include "esp_timer.h"
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        // The order a PIP inverter polls in: the charge limits, the state of charge, then the cell voltages,
+        // temperatures and the remaining status values. The limits are also read as one block, like some
+        // firmware versions do.
+        const ReadRequest MPPInverterSimulator::POLLING_CYCLE[] = {
+            {0x0070, 1}, {0x0071, 1}, {0x0072, 1}, {0x0073, 1}, {0x0074, 1},
+            {0x0033, 1},
+            {0x0010, 1},
+            {0x0011, 1}, {0x0012, 1}, {0x0013, 1}, {0x0014, 1}, {0x0015, 1}, {0x0016, 1}, {0x0017, 1}, {0x0018, 1},
+            {0x0019, 1}, {0x001A, 1}, {0x001B, 1}, {0x001C, 1}, {0x001D, 1}, {0x001E, 1}, {0x001F, 1}, {0x0020, 1},
+            {0x0025, 1},
+            {0x0026, 1}, {0x0027, 1}, {0x0028, 1}, {0x0029, 1},
+            {0x0030, 1}, {0x0031, 1}, {0x0032, 1}, {0x0034, 2},
+            {0x0040, 1}, {0x0050, 1},
+            {0x0060, 1}, {0x0061, 1}, {0x0062, 1}, {0x0063, 1}, {0x0064, 1}, {0x0065, 1},
+            {0x0070, 5},
+        };
+        const size_t MPPInverterSimulator::POLLING_CYCLE_LENGTH = sizeof(POLLING_CYCLE) / sizeof(POLLING_CYCLE[0]);
+
+        void MPPInverterSimulator::loop()
+        {
+            const int64_t nowUs = esp_timer_get_time();
+
+            if (_state == State::WaitingToSend)
+            {
+                if (nowUs - _lastRequestDoneAtUs >= (int64_t)_requestGapMs * 1000)
+                    sendRequest(nowUs);
+                return;
+            }
+
+            int64_t arrivalUs;
+            const size_t readLength = _uart->readAvailable(_reply.data() + _replyLength, _reply.size() - _replyLength, &arrivalUs);
+            if (readLength > 0 && _replyLength == 0)
+                _replyStartedAtUs = arrivalUs - _uart->characterTimeUs();
+            _replyLength += readLength;
+
+            const size_t expectedLength = expectedReplyLength(_reply.data(), _replyLength);
+            if (expectedLength != 0 && _replyLength >= expectedLength)
+            {
+                _stats.replies++;
+
+                const uint32_t latencyUs = (uint32_t)(_replyStartedAtUs - _requestEndsAtUs);
+                _stats.replyLatency.record(latencyUs);
+                if (latencyUs > _lateReplyUs)
+                    _stats.lateReplies++;
+
+                // Running the CRC over the received CRC too yields 0 for a valid frame
+                if (_replyLength != expectedLength || (_reply[1] & 0x80) != 0 || ModbusCrc16::compute(_reply.data(), expectedLength) != 0)
+                {
+                    ESP_LOGW("MPPInverterSimulator", "Invalid reply to 0x%04X.", POLLING_CYCLE[_cycleIndex].dataAddress);
+                    _stats.invalidReplies++;
+                }
+
+                finishRequest(nowUs);
+            }
+            else if (nowUs - _requestEndsAtUs > (int64_t)_replyTimeoutMs * 1000)
+            {
+                ESP_LOGW("MPPInverterSimulator", "No reply to 0x%04X.", POLLING_CYCLE[_cycleIndex].dataAddress);
+                _stats.missedReplies++;
+                finishRequest(nowUs);
+            }
+        }
+
+        void MPPInverterSimulator::dump_config()
+        {
+            const LatencyHistogram &latency = _stats.replyLatency;
+            ESP_LOGI("MPPInverterSimulator", "MPPInverterSimulator:");
+            ESP_LOGI("MPPInverterSimulator", "  Requests: %lu sent, %lu replied, %lu missed, %lu late, %lu invalid",
+                     _stats.requests, _stats.replies, _stats.missedReplies, _stats.lateReplies, _stats.invalidReplies);
+            ESP_LOGI("MPPInverterSimulator", "  Reply latency: p50 %lu us, p90 %lu us, p99 %lu us, max %lu us",
+                     latency.percentileUs(50), latency.percentileUs(90), latency.percentileUs(99), latency.maxUs());
+            if (_stats.cycles != 0)
+                ESP_LOGI("MPPInverterSimulator", "  Polling cycles: %lu, last %lu ms, min %lu ms, max %lu ms",
+                         _stats.cycles, _stats.lastCycleMs, _stats.minCycleMs, _stats.maxCycleMs);
+        }
+
+        void MPPInverterSimulator::sendRequest(int64_t nowUs)
+        {
+            const ReadRequest &request = POLLING_CYCLE[_cycleIndex];
+            if (_cycleIndex == 0)
+                _cycleStartedAtUs = nowUs;
+
+            std::array<uint8_t, 8> frame = ModbusCrc16::withCrc(std::array<uint8_t, 6>{
+                SLAVE_ID, COMMAND_READ_DATA,
+                (uint8_t)(request.dataAddress >> 8), (uint8_t)request.dataAddress,
+                (uint8_t)(request.dataLength >> 8), (uint8_t)request.dataLength});
+
+            // Whatever arrived after a timeout belongs to an older request
+            while (this->read_available(_reply.data(), _reply.size()) > 0)
+                ;
+            _replyLength = 0;
+
+            this->write_array(frame.data(), frame.size());
+            _requestEndsAtUs = _uart->getTxDoneAtUs();
+            _stats.requests++;
+            _state = State::WaitingForReply;
+        }
+
+        size_t MPPInverterSimulator::expectedReplyLength(const uint8_t *reply, size_t received)
+        {
+            if (received < 2)
+                return 0;
+
+            // [id][fn | 0x80][code][crcL][crcH]
+            if ((reply[1] & 0x80) != 0)
+                return 5;
+
+            // [id][fn][regsH][regsL][payload][crcL][crcH]
+            if (received < 4)
+                return 0;
+            const size_t registers = (reply[2] << 8) | reply[3];
+            return registers <= 125 ? 4 + registers * 2 + 2 : MAX_REPLY_SIZE;
+        }
+
+        void MPPInverterSimulator::finishRequest(int64_t nowUs)
+        {
+            _state = State::WaitingToSend;
+            _lastRequestDoneAtUs = nowUs;
+
+            if (++_cycleIndex < POLLING_CYCLE_LENGTH)
+                return;
+
+            _cycleIndex = 0;
+            _stats.cycles++;
+            _stats.lastCycleMs = (uint32_t)((nowUs - _cycleStartedAtUs) / 1000);
+            if (_stats.lastCycleMs < _stats.minCycleMs)
+                _stats.minCycleMs = _stats.lastCycleMs;
+            if (_stats.lastCycleMs > _stats.maxCycleMs)
+                _stats.maxCycleMs = _stats.lastCycleMs;
+        }
+    } // namespace mppsolar
+} // namespace sdragos
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <array>
+#include "bms_lib_protocol_request_predictor.h"
+#include "latency_histogram.h"
+#include "virtual_uart_component.h"
+#include "esphome/components/uart/uart.h"
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        /// @brief Plays the inverter side of the Lib protocol over a VirtualUARTComponent, so the handler can be
+        ///        exercised and its reply times compared between changes without a PIP inverter on the bench.
+        ///        The polling cycle of a PIP inverter is replayed over and over, one request at a time, with a
+        ///        configurable gap after each reply. Reply latency is measured on the simulated line, from the
+        ///        end of the request to the start of the reply, so it does not depend on how often loop() runs.
+        class MPPInverterSimulator : public esphome::uart::UARTDevice, public Component
+        {
+        public:
+            struct Stats
+            {
+                uint32_t requests = 0;
+                uint32_t replies = 0;
+                // No reply within the reply timeout
+                uint32_t missedReplies = 0;
+                // Replies that started later than the late reply threshold
+                uint32_t lateReplies = 0;
+                // Replies with a bad CRC or an exception code
+                uint32_t invalidReplies = 0;
+
+                LatencyHistogram replyLatency;
+
+                // Full polling cycles, from the first request to the end of the last reply
+                uint32_t cycles = 0;
+                uint32_t lastCycleMs = 0;
+                uint32_t minCycleMs = UINT32_MAX;
+                uint32_t maxCycleMs = 0;
+            };
+
+            explicit MPPInverterSimulator(VirtualUARTComponent *uart) : UARTDevice(uart), _uart(uart) {}
+
+            // Silence between a reply (or a missed one) and the next request
+            void setRequestGapMs(uint32_t requestGapMs) { _requestGapMs = requestGapMs; }
+            void setReplyTimeoutMs(uint32_t replyTimeoutMs) { _replyTimeoutMs = replyTimeoutMs; }
+            void setLateReplyUs(uint32_t lateReplyUs) { _lateReplyUs = lateReplyUs; }
+
+            void setup() override {}
+            void loop() override;
+            void dump_config() override;
+            float get_setup_priority() const override { return 0.0f; }
+            const Stats &getStats() const { return _stats; }
+
+        private:
+            static constexpr uint8_t SLAVE_ID = 0x01;
+            static constexpr uint8_t COMMAND_READ_DATA = 0x03;
+            // Largest reply the handler sends, a block read of 125 registers
+            static constexpr size_t MAX_REPLY_SIZE = 4 + 2 * 125 + 2;
+
+            static const ReadRequest POLLING_CYCLE[];
+            static const size_t POLLING_CYCLE_LENGTH;
+
+            enum class State
+            {
+                WaitingToSend,
+                WaitingForReply,
+            };
+
+            void sendRequest(int64_t nowUs);
+            // Returns the length of the reply once enough bytes were received to know it, 0 before
+            static size_t expectedReplyLength(const uint8_t *reply, size_t received);
+            void finishRequest(int64_t nowUs);
+
+            VirtualUARTComponent *_uart;
+
+            uint32_t _requestGapMs = 50;
+            uint32_t _replyTimeoutMs = 500;
+            uint32_t _lateReplyUs = 20000;
+
+            State _state = State::WaitingToSend;
+            size_t _cycleIndex = 0;
+            int64_t _cycleStartedAtUs = 0;
+            int64_t _requestEndsAtUs = 0;
+            int64_t _lastRequestDoneAtUs = 0;
+
+            std::array<uint8_t, MAX_REPLY_SIZE> _reply{};
+            size_t _replyLength = 0;
+            int64_t _replyStartedAtUs = 0;
+
+            Stats _stats;
+        }; // class MPPInverterSimulator
+    } // namespace mppsolar
+} // namespace sdragos
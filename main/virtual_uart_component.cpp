@@ -0,0 +1,179 @@
+#include "virtual_uart_component.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <algorithm>
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        namespace
+        {
+            // Sleeps whole ticks, which lets the lower priority tasks run, and waits out the rest that
+            // FreeRTOS can't sleep for
+            void waitUntil(int64_t untilUs)
+            {
+                constexpr int64_t TICK_US = portTICK_PERIOD_MS * 1000LL;
+                int64_t remainingUs;
+                while ((remainingUs = untilUs - esp_timer_get_time()) > 0)
+                {
+                    if (remainingUs >= TICK_US)
+                        vTaskDelay(remainingUs / TICK_US);
+                    else
+                        esp_rom_delay_us((uint32_t)remainingUs);
+                }
+            }
+        } // namespace
+
+        VirtualUARTComponent::VirtualUARTComponent()
+        {
+            _lock = xSemaphoreCreateMutex();
+            _dataWritten = xSemaphoreCreateBinary();
+        }
+
+        void VirtualUARTComponent::connect(VirtualUARTComponent *first, VirtualUARTComponent *second)
+        {
+            first->_peer = second;
+            second->_peer = first;
+        }
+
+        void VirtualUARTComponent::write_array(const uint8_t *data, size_t len)
+        {
+            if (_peer == nullptr || len == 0)
+                return;
+
+            // Like a UART with no TX buffer, the bytes are queued right after the ones still being sent
+            const uint32_t characterUs = characterTimeUs();
+            int64_t arrivalUs = std::max(esp_timer_get_time(), _txBusyUntilUs);
+
+            xSemaphoreTake(_peer->_lock, portMAX_DELAY);
+            for (size_t i = 0; i < len; i++)
+            {
+                arrivalUs += characterUs;
+                _peer->receive(data[i], arrivalUs);
+            }
+            xSemaphoreGive(_peer->_lock);
+
+            _txBusyUntilUs = arrivalUs;
+            xSemaphoreGive(_peer->_dataWritten);
+        }
+
+        bool VirtualUARTComponent::peek_byte(uint8_t *data)
+        {
+            bool peeked = false;
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            if (arrivedCount(esp_timer_get_time()) > 0)
+            {
+                *data = _rxBuffer[_rxHead].value;
+                peeked = true;
+            }
+            xSemaphoreGive(_lock);
+            return peeked;
+        }
+
+        bool VirtualUARTComponent::read_array(uint8_t *data, size_t len)
+        {
+            if (!this->check_read_timeout_(len))
+                return false;
+
+            return read_available(data, len) == len;
+        }
+
+        size_t VirtualUARTComponent::read_available(uint8_t *data, size_t max_len)
+        {
+            int64_t firstArrivalUs;
+            return readAvailable(data, max_len, &firstArrivalUs);
+        }
+
+        size_t VirtualUARTComponent::readAvailable(uint8_t *data, size_t max_len, int64_t *firstArrivalUs)
+        {
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            const size_t length = std::min(arrivedCount(esp_timer_get_time()), max_len);
+            if (length > 0)
+                *firstArrivalUs = _rxBuffer[_rxHead].arrivalUs;
+            for (size_t i = 0; i < length; i++)
+            {
+                data[i] = _rxBuffer[_rxHead].value;
+                _rxHead = (_rxHead + 1) % RX_BUFFER_SIZE;
+            }
+            _rxCount -= length;
+            xSemaphoreGive(_lock);
+
+            return length;
+        }
+
+        int VirtualUARTComponent::available()
+        {
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            const size_t count = arrivedCount(esp_timer_get_time());
+            xSemaphoreGive(_lock);
+            return count;
+        }
+
+        void VirtualUARTComponent::flush()
+        {
+            waitUntil(_txBusyUntilUs);
+        }
+
+        bool VirtualUARTComponent::is_tx_done()
+        {
+            return esp_timer_get_time() >= _txBusyUntilUs;
+        }
+
+        bool VirtualUARTComponent::waitForData(TickType_t timeout)
+        {
+            int64_t lastArrivalUs = 0;
+            xSemaphoreTake(_lock, portMAX_DELAY);
+            bool pending = _rxCount > 0;
+            if (pending)
+                lastArrivalUs = _rxBuffer[(_rxHead + _rxCount - 1) % RX_BUFFER_SIZE].arrivalUs;
+            xSemaphoreGive(_lock);
+
+            if (!pending)
+            {
+                if (xSemaphoreTake(_dataWritten, timeout) != pdTRUE)
+                    return false;
+                return waitForData(0);
+            }
+
+            // The bytes are already written, wait until the last of them is on the line. This mimics the
+            // receive timeout of the hardware UART, which reports a burst of bytes once it is complete.
+            waitUntil(lastArrivalUs);
+            return true;
+        }
+
+        uint32_t VirtualUARTComponent::characterTimeUs() const
+        {
+            if (baud_rate_ == 0)
+                return 0;
+
+            // start bit + data bits + optional parity bit + stop bits
+            uint32_t bits = 1 + data_bits_ + stop_bits_;
+            if (parity_ != UART_CONFIG_PARITY_NONE)
+                bits++;
+            return (bits * 1000000UL + baud_rate_ - 1) / baud_rate_;
+        }
+
+        void VirtualUARTComponent::receive(uint8_t value, int64_t arrivalUs)
+        {
+            if (_rxCount == RX_BUFFER_SIZE)
+            {
+                _overflows++;
+                return;
+            }
+
+            _rxBuffer[(_rxHead + _rxCount) % RX_BUFFER_SIZE] = ReceivedByte{value, arrivalUs};
+            _rxCount++;
+        }
+
+        size_t VirtualUARTComponent::arrivedCount(int64_t nowUs) const
+        {
+            // Arrival times only grow, so the arrived bytes are the ones before the first future one
+            size_t count = 0;
+            while (count < _rxCount && _rxBuffer[(_rxHead + count) % RX_BUFFER_SIZE].arrivalUs <= nowUs)
+                count++;
+            return count;
+        }
+    } // namespace mppsolar
+} // namespace sdragos
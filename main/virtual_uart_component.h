@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <array>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esphome/components/uart/uart_component.h"
+
+using namespace esphome;
+using namespace uart;
+
+namespace sdragos
+{
+    namespace mppsolar
+    {
+        /// @brief In-process UART with two connected ends, used to run the Lib protocol handler against a simulated
+        ///        inverter without any hardware.
+        ///        Bytes written to one end are received by the other one at the time they would have arrived on
+        ///        a real line at the configured baud rate, one character time after the other, so inter-frame
+        ///        silences and reply latencies behave like on the bus.
+        class VirtualUARTComponent : public UARTComponent
+        {
+        public:
+            static constexpr size_t RX_BUFFER_SIZE = 512;
+
+            VirtualUARTComponent();
+
+            // Connects two ends, what one writes the other reads.
+            static void connect(VirtualUARTComponent *first, VirtualUARTComponent *second);
+
+            void write_array(const uint8_t *data, size_t len) override;
+
+            bool peek_byte(uint8_t *data) override;
+            bool read_array(uint8_t *data, size_t len) override;
+            size_t read_available(uint8_t *data, size_t max_len) override;
+
+            int available() override;
+            // Blocks until the written bytes have left the line
+            void flush() override;
+            bool is_tx_done() override;
+
+            // Blocks until bytes written by the other end have arrived or the timeout expires. Returns true
+            // when bytes can be read.
+            bool waitForData(TickType_t timeout);
+
+            // Like read_available(), and also returns the time the first of the bytes that were read arrived at.
+            size_t readAvailable(uint8_t *data, size_t max_len, int64_t *firstArrivalUs);
+
+            // When the last byte written by this end is completely on the line
+            int64_t getTxDoneAtUs() const { return _txBusyUntilUs; }
+            uint32_t characterTimeUs() const;
+            uint32_t getOverflows() const { return _overflows; }
+
+        private:
+            struct ReceivedByte
+            {
+                uint8_t value;
+                int64_t arrivalUs;
+            };
+
+            // Called by the other end with the lock of this end taken
+            void receive(uint8_t value, int64_t arrivalUs);
+            // Number of buffered bytes that have arrived by now, with the lock taken
+            size_t arrivedCount(int64_t nowUs) const;
+
+            VirtualUARTComponent *_peer = nullptr;
+            SemaphoreHandle_t _lock;
+            // Given each time the other end writes
+            SemaphoreHandle_t _dataWritten;
+
+            std::array<ReceivedByte, RX_BUFFER_SIZE> _rxBuffer{};
+            size_t _rxHead = 0;
+            size_t _rxCount = 0;
+            uint32_t _overflows = 0;
+
+            // When the last byte written by this end has been sent out
+            int64_t _txBusyUntilUs = 0;
+        }; // class VirtualUARTComponent
+    } // namespace mppsolar
+} // namespace sdragos